@@ -0,0 +1,71 @@
+#include "Activation.h"
+#include "Kernels.h"
+
+const char *Activation::name(Kind kind) {
+	static const char *names[] = { "tanh", "fasttanh", "sigmoid", "relu", "leakyrelu", "linear" };
+	return names[kind];
+}
+
+bool Activation::parse(const string &name, Kind &kind) {
+	string upperWanted = name;
+	cap(upperWanted);
+	for (unsigned k = 0; k < numKinds; ++k) {
+		string upperName = Activation::name(Kind(k));
+		cap(upperName);
+		if (upperName == upperWanted) { kind = Kind(k); return true; }
+	}
+	return false;
+}
+
+bool Activation::readSection(const char *data, uint64_t bytes, unsigned numLayers, vector<Kind> &kinds) {
+	if (bytes != uint64_t(numLayers) * sizeof(uint32_t)) return false;
+	kinds.resize(numLayers);
+	for (unsigned l = 0; l < numLayers; ++l) {
+		uint32_t kind;
+		memcpy(&kind, data + l * sizeof(uint32_t), sizeof(kind));
+		if (kind >= numKinds) return false;
+		kinds[l] = Kind(kind);
+	}
+	return true;
+}
+
+template <class Policy, typename T>
+static void applyPolicy(T *values, unsigned n) {
+	for (unsigned i = 0; i < n; ++i) values[i] = Policy::value(values[i]);
+}
+
+template <class Policy, typename T>
+static void multiplyPolicyDerivative(const T *outputs, T *gradients, unsigned n) {
+	for (unsigned i = 0; i < n; ++i) gradients[i] = gradients[i] * Policy::derivative(outputs[i]);
+}
+
+/* the switch is made once per row, the loops inside it see a single policy. the fast tanh runs as one
+   vectorized pass. */
+template <typename T>
+void Activation::apply(Kind kind, T *values, unsigned n) {
+	switch (kind) {
+	case TANH: applyPolicy<TanhActivation>(values, n); break;
+	case FAST_TANH: Kernels::fastTanh(values, n); break;
+	case SIGMOID: applyPolicy<SigmoidActivation>(values, n); break;
+	case RELU: applyPolicy<ReluActivation>(values, n); break;
+	case LEAKY_RELU: applyPolicy<LeakyReluActivation>(values, n); break;
+	case LINEAR: break;
+	}
+}
+
+template <typename T>
+void Activation::multiplyDerivative(Kind kind, const T *outputs, T *gradients, unsigned n) {
+	switch (kind) {
+	case TANH: multiplyPolicyDerivative<TanhActivation>(outputs, gradients, n); break;
+	case FAST_TANH: multiplyPolicyDerivative<FastTanhActivation>(outputs, gradients, n); break;
+	case SIGMOID: multiplyPolicyDerivative<SigmoidActivation>(outputs, gradients, n); break;
+	case RELU: multiplyPolicyDerivative<ReluActivation>(outputs, gradients, n); break;
+	case LEAKY_RELU: multiplyPolicyDerivative<LeakyReluActivation>(outputs, gradients, n); break;
+	case LINEAR: break;
+	}
+}
+
+template void Activation::apply(Kind kind, double *values, unsigned n);
+template void Activation::apply(Kind kind, float *values, unsigned n);
+template void Activation::multiplyDerivative(Kind kind, const double *outputs, double *gradients, unsigned n);
+template void Activation::multiplyDerivative(Kind kind, const float *outputs, float *gradients, unsigned n);
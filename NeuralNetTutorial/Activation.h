@@ -0,0 +1,68 @@
+#pragma once
+#ifndef Activation_H
+#define Activation_H
+#include "Globalfuncs.h"
+#include "Kernels.h"
+using namespace std;
+
+/* the transfer functions a layer can put its sums through. each policy has value(x) and derivative(y), where the
+   derivative is written in terms of the output y = value(x): back propagation only keeps the outputs. a policy
+   can be picked at compile time (StaticNet takes one as a template argument) and every one of them has a Kind,
+   which is how a Net picks one per layer at run time and how checkpoints store them. */
+struct TanhActivation {
+	template <typename T> static T value(T x) { return tanh(x); }             // output range [-1.0..1.0]
+	template <typename T> static T derivative(T y) { return T(1) - y * y; }
+};
+
+/* tanh to within 4e-7 (Kernels::fastTanh), a few multiplies and one divide instead of libm's exponentials. */
+struct FastTanhActivation {
+	template <typename T> static T value(T x) { return Kernels::fastTanh(x); }
+	template <typename T> static T derivative(T y) { return T(1) - y * y; }
+};
+
+struct SigmoidActivation {
+	template <typename T> static T value(T x) { return T(1) / (T(1) + exp(-x)); }   // output range [0.0..1.0]
+	template <typename T> static T derivative(T y) { return y * (T(1) - y); }
+};
+
+struct ReluActivation {
+	template <typename T> static T value(T x) { return x > T(0) ? x : T(0); }
+	template <typename T> static T derivative(T y) { return y > T(0) ? T(1) : T(0); }
+};
+
+struct LeakyReluActivation {
+	static constexpr double slope = 0.01;       // of the negative side
+	template <typename T> static T value(T x) { return x > T(0) ? x : T(slope) * x; }
+	template <typename T> static T derivative(T y) { return y > T(0) ? T(1) : T(slope); }
+};
+
+struct LinearActivation {                       // for output layers that shouldn't be squashed
+	template <typename T> static T value(T x) { return x; }
+	template <typename T> static T derivative(T) { return T(1); }
+};
+
+class Activation {
+public:
+	enum Kind { TANH, FAST_TANH, SIGMOID, RELU, LEAKY_RELU, LINEAR };
+	static const unsigned numKinds = LINEAR + 1;
+	static const char *name(Kind kind);
+	static bool parse(const string &name, Kind &kind);   // tanh, fasttanh, sigmoid, relu, leakyrelu or linear, any case
+	// values[i] = value(values[i]) over a whole row of a layer's sums
+	template <typename T>
+	static void apply(Kind kind, T *values, unsigned n);
+	// gradients[i] *= derivative(outputs[i])
+	template <typename T>
+	static void multiplyDerivative(Kind kind, const T *outputs, T *gradients, unsigned n);
+	// the "ACTV" checkpoint section holds one uint32 Kind per layer after the input layer. false if it is damaged
+	static bool readSection(const char *data, uint64_t bytes, unsigned numLayers, vector<Kind> &kinds);
+};
+
+/* the Kind of each policy, for StaticNet's checkpoints. */
+template <class Policy> struct ActivationKind;
+template <> struct ActivationKind<TanhActivation> { static const Activation::Kind kind = Activation::TANH; };
+template <> struct ActivationKind<FastTanhActivation> { static const Activation::Kind kind = Activation::FAST_TANH; };
+template <> struct ActivationKind<SigmoidActivation> { static const Activation::Kind kind = Activation::SIGMOID; };
+template <> struct ActivationKind<ReluActivation> { static const Activation::Kind kind = Activation::RELU; };
+template <> struct ActivationKind<LeakyReluActivation> { static const Activation::Kind kind = Activation::LEAKY_RELU; };
+template <> struct ActivationKind<LinearActivation> { static const Activation::Kind kind = Activation::LINEAR; };
+#endif // !Activation_H
@@ -0,0 +1,268 @@
+#include "Globalfuncs.h"
+#include "LearnData.h"
+#include "Net.h"
+#include "EpochTrainer.h"
+#include "Kernels.h"
+#include <atomic>
+#include <new>
+
+/* the benchmark program (NeuralNetBenchmark, built by the CMake build next to NeuralNetSupervised). it times the
+   hot paths one at a time over a matrix of topologies on synthetic data and prints one JSON document:
+     feedForward   Net::feedForward, one sample at a time
+     backProp      Net::backProp, the time of feedForward + backProp minus the feedForward time above (timing
+                   every call on its own would cost as much as a small net's backProp)
+     parseText     LearnData reading a text data file from start to end, one sample = one row
+     parseBinary   the same rows from the binary (memory mapped) version of that file
+     writeNet      Net::writeNet, one sample = one whole checkpoint
+     readNet       Net::readNet of that checkpoint
+   every result has samples/sec, ns/sample and the bytes (and number of) allocations made while it was timed.
+   given a real data file, it also trains a fresh net of the file's topology with every optimizer (each at its
+   default rate, from the same starting weights and with the same shuffles) and reports how long each took to get
+   the training error of an epoch down to target, under "optimizers".
+   usage:
+     NeuralNetBenchmark [topologies=3-4-3-2,64-128-64-10,...] [samples=N] [seconds=S] [dir=path] [out=file.json]
+                        [data=learnData.txt target=F epochs=N batch=N]
+   samples is the size of the synthetic data set, seconds the least time each measurement runs for. */
+
+/* every allocation in the program goes through here, so a result can say what the code it timed allocated. */
+static atomic<uint64_t> allocatedBytes(0), allocationCount(0);
+
+void *operator new(size_t size) {
+	allocatedBytes += size;
+	++allocationCount;
+	if (void *p = malloc(size > 0 ? size : 1)) return p;
+	throw bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+struct Result {
+	string benchmark;
+	string topology;
+	uint64_t samples;       // samples processed in the timed run
+	double seconds;
+	uint64_t bytesAllocated;
+	uint64_t allocations;
+};
+
+/* calls run(n) (which processes n samples) with n doubling until one call lasts at least minSeconds, after an
+   untimed warm up call. the last call is the one reported. */
+template <typename Run>
+Result measure(const string &benchmark, const string &topology, double minSeconds, Run run) {
+	run(1);
+	Result result = { benchmark, topology, 0, 0.0, 0, 0 };
+	for (uint64_t n = 1; ; n *= 2) {
+		uint64_t bytesBefore = allocatedBytes, allocationsBefore = allocationCount;
+		chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+		run(n);
+		result.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+		result.samples = n;
+		result.bytesAllocated = allocatedBytes - bytesBefore;
+		result.allocations = allocationCount - allocationsBefore;
+		if (result.seconds >= minSeconds) return result;
+	}
+}
+
+static bool parseTopology(const string &name, vector<unsigned> &topology) {
+	topology.clear();
+	stringstream ss(name);
+	string size;
+	while (getline(ss, size, '-')) {
+		char *end;
+		unsigned long value = strtoul(size.c_str(), &end, 10);
+		if (size.empty() || *end != '\0' || value == 0) return false;
+		topology.push_back(unsigned(value));
+	}
+	return topology.size() >= 2;
+}
+
+/* a text data file of numSamples random rows: inputs in [0, 1], targets 0 or 1. */
+static void writeTextData(const string &fileName, const vector<unsigned> &topology, unsigned numSamples) {
+	ofstream outFile(fileName.c_str());
+	outFile << "topology:";
+	for (unsigned i = 0; i < topology.size(); ++i) outFile << " " << topology[i];
+	outFile << "\n";
+	for (unsigned s = 0; s < numSamples; ++s) {
+		outFile << "in:";
+		for (unsigned i = 0; i < topology.front(); ++i) outFile << " " << rand() / double(RAND_MAX);
+		outFile << "\nout:";
+		for (unsigned n = 0; n < topology.back(); ++n) outFile << " " << rand() % 2;
+		outFile << "\n";
+	}
+}
+
+/* reads a data file from start to end n times, returns the rows seen. */
+static uint64_t readAll(const string &fileName, uint64_t n) {
+	uint64_t rows = 0;
+	for (uint64_t pass = 0; pass < n; ++pass) {
+		LearnData data(fileName);
+		vector<unsigned> topology;
+		data.getTopology(topology);     // also tells the reader the row sizes
+		const double *samples;
+		unsigned count;
+		while ((count = data.getNextBatch(samples, 1024)) > 0) rows += count;
+	}
+	return rows;
+}
+
+static void benchmarkTopology(const vector<unsigned> &topology, unsigned numSamples, double minSeconds, const string &dir, vector<Result> &results) {
+	string name = topologyString(topology);
+	Net net(topology);
+	unsigned poolSize = min(numSamples, 1024u);   // rows the per sample loops cycle through
+	vector<vector<double> > inputs(poolSize, vector<double>(topology.front())), targets(poolSize, vector<double>(topology.back()));
+	for (unsigned s = 0; s < poolSize; ++s) {
+		for (unsigned i = 0; i < inputs[s].size(); ++i) inputs[s][i] = rand() / double(RAND_MAX);
+		for (unsigned n = 0; n < targets[s].size(); ++n) targets[s][n] = rand() % 2;
+	}
+	Result forward = measure("feedForward", name, minSeconds, [&](uint64_t n) {
+		for (uint64_t s = 0; s < n; ++s) net.feedForward(inputs[s % poolSize]);
+	});
+	Result train = measure("backProp", name, minSeconds, [&](uint64_t n) {
+		for (uint64_t s = 0; s < n; ++s) {
+			net.feedForward(inputs[s % poolSize]);
+			net.backProp(targets[s % poolSize]);
+		}
+	});
+	double forwardPerSample = forward.seconds / forward.samples;
+	train.seconds = max(0.0, train.seconds - forwardPerSample * train.samples);
+	results.push_back(forward);
+	results.push_back(train);
+
+	// the data file is kept to about 4M values, so wide topologies don't write gigabytes
+	unsigned fileSamples = unsigned(min<uint64_t>(numSamples, max<uint64_t>(1, (4u << 20) / (topology.front() + topology.back()))));
+	string textName = dir + "/nnbench_data.txt", binaryName = dir + "/nnbench_data.bin", checkpointName = dir + "/nnbench.ckpt";
+	writeTextData(textName, topology, fileSamples);
+	if (!LearnData::convertToBinary(textName, binaryName)) throw runtime_error("couldn't write " + binaryName);
+	Result parseText = measure("parseText", name, minSeconds, [&](uint64_t n) { readAll(textName, n); });
+	parseText.samples *= fileSamples;
+	results.push_back(parseText);
+	Result parseBinary = measure("parseBinary", name, minSeconds, [&](uint64_t n) { readAll(binaryName, n); });
+	parseBinary.samples *= fileSamples;
+	results.push_back(parseBinary);
+	remove(textName.c_str());
+	remove(binaryName.c_str());
+
+	results.push_back(measure("writeNet", name, minSeconds, [&](uint64_t n) {
+		for (uint64_t i = 0; i < n; ++i) net.writeNet(checkpointName);
+	}));
+	results.push_back(measure("readNet", name, minSeconds, [&](uint64_t n) {
+		for (uint64_t i = 0; i < n; ++i) net.readNet(checkpointName);
+	}));
+	remove(checkpointName.c_str());
+}
+
+struct OptimizerResult {
+	NetConfig config;
+	EpochTrainer::Report report;
+};
+
+/* time to target error of every optimizer on dataName, each trained for all of its epochs. */
+static void benchmarkOptimizers(const string &dataName, double targetError, unsigned epochs, unsigned batchSize, vector<OptimizerResult> &results) {
+	LearnData data(dataName);
+	vector<unsigned> topology;
+	data.getTopology(topology);
+	if (topology.size() < 2) throw runtime_error("couldn't read the topology of " + dataName);
+	uint64_t numSamples;
+	const double *samples = data.getAllSamples(numSamples);
+	EpochTrainer::Options options;
+	options.epochs = epochs;
+	options.batchSize = batchSize;
+	options.shuffle = true;
+	options.targetError = targetError;
+	for (unsigned o = NetConfig::MOMENTUM; o <= NetConfig::ADAM; ++o) {
+		OptimizerResult result;
+		result.config.optimizer = NetConfig::Optimizer(o);
+		result.config.eta = NetConfig::defaultEta(result.config.optimizer);
+		cerr << "training with " << NetConfig::optimizerName(result.config.optimizer) << "...\n";
+		srand(1);
+		Net net(topology, result.config);
+		EpochTrainer trainer(net, samples, numSamples, options);
+		vector<double> inputVals, targetVals, resultVals;
+		result.report = trainer.train(NULL, NULL, inputVals, targetVals, resultVals);
+		results.push_back(result);
+	}
+}
+
+static void writeJson(ostream &out, const vector<Result> &results, const vector<OptimizerResult> &optimizers, double targetError,
+	unsigned numSamples, double minSeconds) {
+	out << "{\n  \"kernels\": \"" << Kernels::name() << "\",\n  \"samples\": " << numSamples
+		<< ",\n  \"min_seconds\": " << minSeconds << ",\n  \"results\": [\n";
+	for (unsigned r = 0; r < results.size(); ++r) {
+		const Result &result = results[r];
+		double perSample = result.samples > 0 ? result.seconds / result.samples : 0.0;
+		out << "    {\"benchmark\": \"" << result.benchmark << "\", \"topology\": \"" << result.topology
+			<< "\", \"samples\": " << result.samples << ", \"seconds\": " << result.seconds
+			<< ", \"samples_per_sec\": " << (perSample > 0.0 ? 1.0 / perSample : 0.0) << ", \"ns_per_sample\": " << perSample * 1e9
+			<< ", \"bytes_allocated\": " << result.bytesAllocated << ", \"allocations\": " << result.allocations << "}"
+			<< (r + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "  ]";
+	if (!optimizers.empty()) {
+		out << ",\n  \"target_error\": " << targetError << ",\n  \"optimizers\": [\n";
+		for (unsigned o = 0; o < optimizers.size(); ++o) {
+			const EpochTrainer::Report &report = optimizers[o].report;
+			out << "    {\"optimizer\": \"" << NetConfig::optimizerName(optimizers[o].config.optimizer) << "\", \"eta\": " << optimizers[o].config.eta
+				<< ", \"reached_target\": " << (report.reachedTarget ? "true" : "false") << ", \"seconds_to_target\": " << (report.reachedTarget ? report.targetSeconds : -1.0)
+				<< ", \"samples_to_target\": " << (report.reachedTarget ? report.targetSamples : 0) << ", \"epochs\": " << report.epochs
+				<< ", \"best_error\": " << report.bestError << ", \"seconds\": " << report.seconds << "}"
+				<< (o + 1 < optimizers.size() ? ",\n" : "\n");
+		}
+		out << "  ]";
+	}
+	out << "\n}\n";
+}
+
+int main(int argc, char *argv[]) {
+	string topologyList = "3-4-3-2,16-32-16-4,64-128-64-10,256-512-512-10,1024-2048-2048-10", dir = ".", outName, dataName;
+	unsigned numSamples = 100000, epochs = 20, batchSize = 1;
+	double minSeconds = 0.25, targetError = 0.05;
+	for (int a = 1; a < argc; ++a) {
+		string arg = argv[a];
+		size_t equals = arg.find('=');
+		string name = arg.substr(0, equals == string::npos ? arg.size() : equals), value = equals == string::npos ? "" : arg.substr(equals + 1);
+		cap(name);
+		if (name == "TOPOLOGIES") topologyList = value;
+		else if (name == "SAMPLES") numSamples = max(1, atoi(value.c_str()));
+		else if (name == "SECONDS") minSeconds = atof(value.c_str());
+		else if (name == "DIR") dir = value;
+		else if (name == "OUT") outName = value;
+		else if (name == "DATA") dataName = value;
+		else if (name == "TARGET") targetError = atof(value.c_str());
+		else if (name == "EPOCHS") epochs = max(1, atoi(value.c_str()));
+		else if (name == "BATCH") batchSize = max(1, atoi(value.c_str()));
+		else {
+			cerr << "usage: " << argv[0] << " [topologies=3-4-3-2,64-128-64-10,...] [samples=N] [seconds=S] [dir=path] [out=file.json]\n"
+				"  [data=learnData.txt target=F epochs=N batch=N]\n";
+			return 1;
+		}
+	}
+	vector<vector<unsigned> > topologies;
+	stringstream list(topologyList);
+	string topologyWord;
+	while (getline(list, topologyWord, ',')) {
+		vector<unsigned> topology;
+		if (!parseTopology(topologyWord, topology)) { cerr << "Couldn't understand the topology " << topologyWord << ".\n"; return 1; }
+		topologies.push_back(topology);
+	}
+	srand(1);
+	vector<Result> results;
+	vector<OptimizerResult> optimizers;
+	try {
+		for (unsigned t = 0; t < topologies.size(); ++t) {
+			cerr << "benchmarking " << topologyString(topologies[t]) << "...\n";
+			benchmarkTopology(topologies[t], numSamples, minSeconds, dir, results);
+		}
+		if (!dataName.empty()) benchmarkOptimizers(dataName, targetError, epochs, batchSize, optimizers);
+	}
+	catch (runtime_error &e) { cerr << e.what() << "\n"; return 1; }
+	if (outName.empty()) writeJson(cout, results, optimizers, targetError, numSamples, minSeconds);
+	else {
+		ofstream outFile(outName.c_str());
+		writeJson(outFile, results, optimizers, targetError, numSamples, minSeconds);
+		if (!outFile) { cerr << "Couldn't write " << outName << ".\n"; return 1; }
+	}
+	return 0;
+}
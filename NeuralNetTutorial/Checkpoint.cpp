@@ -0,0 +1,219 @@
+#include "Checkpoint.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+/* FNV-1a folded over 64 bit words instead of bytes, so a checkpoint of millions of weights is checked at memory
+   speed. a tail shorter than a word is padded with zeros. */
+uint64_t computeChecksum(const char *data, uint64_t size, uint64_t hash) {
+	uint64_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		hash = (hash ^ word) * 1099511628211ull;
+	}
+	if (i < size) {
+		uint64_t word = 0;
+		memcpy(&word, data + i, size_t(size - i));
+		hash = (hash ^ word) * 1099511628211ull;
+	}
+	return hash;
+}
+
+/* rename() on posix replaces the destination atomically, windows needs to be told it may replace a file. on posix
+   the rename itself only lasts through a power cut once the directory holding toName is synced as well (a file system
+   that can't sync directories says EINVAL, there is nothing more to do then). */
+bool replaceFile(const string &fromName, const string &toName) {
+#ifdef _WIN32
+	return MoveFileExA(fromName.c_str(), toName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	if (rename(fromName.c_str(), toName.c_str()) != 0) return false;
+	size_t slash = toName.find_last_of('/');
+	string directory = slash == string::npos ? "." : slash == 0 ? "/" : toName.substr(0, slash);
+	int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+	if (fd < 0) return false;
+	bool synced = fsync(fd) == 0 || errno == EINVAL;
+	close(fd);
+	return synced;
+#endif
+}
+
+/* pushes fileName's data out of the os's cache onto the disk, so it is there before a rename makes it the checkpoint. */
+static bool syncFile(const string &fileName) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	bool synced = FlushFileBuffers(file) != 0;
+	CloseHandle(file);
+	return synced;
+#else
+	int fd = open(fileName.c_str(), O_RDWR);
+	if (fd < 0) return false;
+	bool synced = fsync(fd) == 0;
+	close(fd);
+	return synced;
+#endif
+}
+
+/* a name next to fileName that no other save uses, in this process (the counter) or any other (the process id), so
+   two saves to the same checkpoint at once never write into each other's temporary file. */
+static string tempFileName(const string &fileName) {
+	static atomic<unsigned> saves(0);
+#ifdef _WIN32
+	uint64_t processId = GetCurrentProcessId();
+#else
+	uint64_t processId = uint64_t(getpid());
+#endif
+	return fileName + "." + to_string(processId) + "." + to_string(saves++) + ".tmp";
+}
+
+string topologyString(const vector<unsigned> &topology) {
+	stringstream ss;
+	for (unsigned i = 0; i < topology.size(); ++i) ss << (i > 0 ? "-" : "") << topology[i];
+	return ss.str();
+}
+
+/* the checkpoint always holds doubles. double arrays are written as they are, others are converted into buffer. */
+static const double *asDoubles(const double *values, uint64_t, vector<double> &) {
+	return values;
+}
+
+template <typename T>
+static const double *asDoubles(const T *values, uint64_t count, vector<double> &buffer) {
+	buffer.assign(values, values + count);
+	return buffer.data();
+}
+
+/* the file is written under a temporary name, synced to the disk and only then renamed over fileName, so neither
+   a crash nor a power cut leaves a half written checkpoint behind: fileName is the old checkpoint or the new one. */
+template <typename T>
+void writeCheckpoint(const string &fileName, const vector<unsigned> &topology, const vector<const T *> &arrays,
+	const vector<CheckpointSection> &sections) {
+	vector<uint32_t> paddedTopology((topology.size() + 1) / 2 * 2, 0);   // keeps the weights 8 byte aligned
+	copy(topology.begin(), topology.end(), paddedTopology.begin());
+	CheckpointHeader header;
+	memcpy(header.magic, CHECKPOINT_MAGIC, 4);
+	header.version = CHECKPOINT_VERSION;
+	header.numLayers = topology.size();
+	header.reserved = 0;
+	header.payloadBytes = paddedTopology.size() * sizeof(uint32_t);
+	header.checksum = computeChecksum(reinterpret_cast<const char *>(paddedTopology.data()), header.payloadBytes);
+	vector<double> converted;
+	for (unsigned a = 0; a < arrays.size(); ++a) {   // every piece is a multiple of 8 bytes, so the checksum chains
+		uint64_t count = uint64_t(topology[a / 2 + 1]) * (topology[a / 2] + 1);
+		header.checksum = computeChecksum(reinterpret_cast<const char *>(asDoubles(arrays[a], count, converted)), count * sizeof(double), header.checksum);
+		header.payloadBytes += count * sizeof(double);
+	}
+	vector<vector<char> > sectionBytes(sections.size());   // header, bytes and padding of every section
+	for (unsigned i = 0; i < sections.size(); ++i) {
+		CheckpointSectionHeader sectionHeader;
+		memset(&sectionHeader, 0, sizeof(sectionHeader));
+		memcpy(sectionHeader.tag, sections[i].tag.data(), min<size_t>(4, sections[i].tag.size()));
+		sectionHeader.bytes = sections[i].bytes;
+		vector<char> &bytes = sectionBytes[i];
+		bytes.assign(sizeof(sectionHeader) + (sections[i].bytes + 7) / 8 * 8, 0);
+		memcpy(bytes.data(), &sectionHeader, sizeof(sectionHeader));
+		if (sections[i].bytes > 0) memcpy(bytes.data() + sizeof(sectionHeader), sections[i].data, size_t(sections[i].bytes));
+		header.checksum = computeChecksum(bytes.data(), bytes.size(), header.checksum);
+		header.payloadBytes += bytes.size();
+	}
+	string tempName = tempFileName(fileName);
+	{
+		ofstream outFile(tempName.c_str(), ios::binary | ios::trunc);
+		outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		outFile.write(reinterpret_cast<const char *>(paddedTopology.data()), paddedTopology.size() * sizeof(uint32_t));
+		for (unsigned a = 0; a < arrays.size(); ++a) {
+			uint64_t count = uint64_t(topology[a / 2 + 1]) * (topology[a / 2] + 1);
+			outFile.write(reinterpret_cast<const char *>(asDoubles(arrays[a], count, converted)), count * sizeof(double));
+		}
+		for (unsigned i = 0; i < sectionBytes.size(); ++i) outFile.write(sectionBytes[i].data(), sectionBytes[i].size());
+		outFile.flush();
+		if (!outFile) {
+			outFile.close();
+			remove(tempName.c_str());
+			throw runtime_error("couldn't write " + tempName);
+		}
+	}
+	if (!syncFile(tempName)) {
+		remove(tempName.c_str());
+		throw runtime_error("couldn't write " + tempName);
+	}
+	if (!replaceFile(tempName, fileName)) {
+		remove(tempName.c_str());
+		throw runtime_error("couldn't replace " + fileName);
+	}
+}
+
+bool readCheckpointTopology(const string &fileName, vector<unsigned> &topology) {
+	MappedFile file;
+	CheckpointHeader header;
+	if (!file.open(fileName) || file.size() < sizeof(header)) return false;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, CHECKPOINT_MAGIC, 4) != 0 || header.numLayers < 2
+		|| file.size() < sizeof(header) + uint64_t(header.numLayers) * sizeof(uint32_t)) return false;
+	const uint32_t *layers = reinterpret_cast<const uint32_t *>(file.data() + sizeof(header));
+	topology.assign(layers, layers + header.numLayers);
+	return true;
+}
+
+/* the whole file is checked before a pointer is handed out, so callers copying from it can't be left half loaded. */
+const double *mapCheckpoint(MappedFile &file, const string &fileName, const vector<unsigned> &topology,
+	vector<CheckpointSection> *sections) {
+	if (!file.open(fileName)) throw runtime_error("couldn't open " + fileName);
+	CheckpointHeader header;
+	if (file.size() < sizeof(header) || memcmp(file.data(), CHECKPOINT_MAGIC, 4) != 0) {
+		file.close();
+		return NULL;
+	}
+	memcpy(&header, file.data(), sizeof(header));
+	if (header.version < 1 || header.version > CHECKPOINT_VERSION) throw runtime_error(fileName + " is a checkpoint version this program can't read");
+	if (file.size() != sizeof(header) + header.payloadBytes) throw runtime_error(fileName + " is truncated");
+	const char *payload = file.data() + sizeof(header);
+	if (computeChecksum(payload, header.payloadBytes) != header.checksum) throw runtime_error(fileName + " is corrupt (checksum mismatch)");
+	uint64_t offset = (uint64_t(header.numLayers) + 1) / 2 * 2 * sizeof(uint32_t);
+	if (header.payloadBytes < offset) throw runtime_error(fileName + " is truncated");
+	const uint32_t *layers = reinterpret_cast<const uint32_t *>(payload);
+	vector<unsigned> stored(layers, layers + header.numLayers);
+	if (stored != topology) {
+		throw runtime_error(fileName + " holds a " + topologyString(stored) + " net, this one is " + topologyString(topology));
+	}
+	uint64_t weightBytes = 0;
+	for (unsigned layerNum = 1; layerNum < topology.size(); ++layerNum) {
+		weightBytes += 2 * uint64_t(topology[layerNum]) * (topology[layerNum - 1] + 1) * sizeof(double);
+	}
+	if (header.payloadBytes < offset + weightBytes || (header.version == 1 && header.payloadBytes != offset + weightBytes)) {
+		throw runtime_error(fileName + " is the wrong size for its topology");
+	}
+	if (sections) sections->clear();
+	for (uint64_t at = offset + weightBytes; at < header.payloadBytes;) {
+		CheckpointSectionHeader sectionHeader;
+		if (header.payloadBytes - at < sizeof(sectionHeader)) throw runtime_error(fileName + " has a truncated section");
+		memcpy(&sectionHeader, payload + at, sizeof(sectionHeader));
+		at += sizeof(sectionHeader);
+		if (sectionHeader.bytes > header.payloadBytes - at || (sectionHeader.bytes + 7) / 8 * 8 > header.payloadBytes - at) {
+			throw runtime_error(fileName + " has a truncated section");
+		}
+		CheckpointSection section = { string(sectionHeader.tag, 4), payload + at, sectionHeader.bytes };
+		if (sections) sections->push_back(section);
+		at += (sectionHeader.bytes + 7) / 8 * 8;
+	}
+	return reinterpret_cast<const double *>(payload + offset);
+}
+
+const CheckpointSection *findSection(const vector<CheckpointSection> &sections, const string &tag) {
+	for (unsigned i = 0; i < sections.size(); ++i) {
+		if (sections[i].tag == tag) return &sections[i];
+	}
+	return NULL;
+}
+
+template void writeCheckpoint(const string &fileName, const vector<unsigned> &topology, const vector<const double *> &arrays,
+	const vector<CheckpointSection> &sections);
+template void writeCheckpoint(const string &fileName, const vector<unsigned> &topology, const vector<const float *> &arrays,
+	const vector<CheckpointSection> &sections);
@@ -0,0 +1,59 @@
+#pragma once
+#ifndef Checkpoint_H
+#define Checkpoint_H
+#include "Globalfuncs.h"
+#include "MappedFile.h"
+using namespace std;
+
+/* the binary checkpoint format (little endian, written by Net::writeNet):
+     CheckpointHeader, then numLayers uint32 topology values padded to a multiple of 8 bytes,
+     then for every layer after the input layer its weights followed by its delta weights (momentum), each in the
+     layer's own row-major layout (one row per neuron, one column per previous layer neuron plus its bias),
+     then (from version 2) any number of sections, each a CheckpointSectionHeader and its bytes padded with zeros to
+     a multiple of 8 bytes.
+   payloadBytes counts everything after the header and checksum is computeChecksum of those bytes. version 1 files,
+   which end after the weights, are still read. */
+struct CheckpointHeader {
+	char magic[4];         // "NNCK"
+	uint32_t version;      // CHECKPOINT_VERSION
+	uint32_t numLayers;
+	uint32_t reserved;
+	uint64_t payloadBytes;
+	uint64_t checksum;
+};
+static const char CHECKPOINT_MAGIC[4] = { 'N', 'N', 'C', 'K' };
+static const uint32_t CHECKPOINT_VERSION = 2;
+
+struct CheckpointSectionHeader {
+	char tag[4];           // what the section holds, readers skip the tags they don't know
+	uint32_t reserved;
+	uint64_t bytes;        // not counting the padding
+};
+/* an optional block of data saved after the weights, such as an optimizer's state. data points at the bytes being
+   written, or at the bytes in the mapped file when reading. */
+struct CheckpointSection {
+	string tag;            // 4 characters
+	const char *data;
+	uint64_t bytes;
+};
+
+static const uint64_t CHECKSUM_SEED = 14695981039346656037ull;
+// 64 bit FNV-1a, 8 bytes at a time. pieces whose sizes are multiples of 8 can be chained by passing the last result as hash
+uint64_t computeChecksum(const char *data, uint64_t size, uint64_t hash = CHECKSUM_SEED);
+bool replaceFile(const string &fromName, const string &toName); // renames over toName in one step and syncs it, false on failure
+string topologyString(const vector<unsigned> &topology);         // "3-4-3-2"
+
+/* everything a net of any kind needs to save and load its weights. arrays holds the weights and delta weights of
+   every layer after the input layer in file order, each topology[l] * (topology[l - 1] + 1) values long. float
+   arrays are converted to double one array at a time as they are written. */
+template <typename T>
+void writeCheckpoint(const string &fileName, const vector<unsigned> &topology, const vector<const T *> &arrays,
+	const vector<CheckpointSection> &sections = vector<CheckpointSection>()); // throws runtime_error
+bool readCheckpointTopology(const string &fileName, vector<unsigned> &topology); // false if the file isn't a checkpoint
+// maps fileName and checks it holds a sound checkpoint of exactly this topology, returns the first layer's weights
+// (the rest follow in file order, valid while file stays open). NULL if the file isn't a checkpoint at all, throws
+// runtime_error if it is one but can't be used. sections (may be NULL) gets the file's sections, pointing into file
+const double *mapCheckpoint(MappedFile &file, const string &fileName, const vector<unsigned> &topology,
+	vector<CheckpointSection> *sections = NULL);
+const CheckpointSection *findSection(const vector<CheckpointSection> &sections, const string &tag); // NULL if there's none
+#endif // !Checkpoint_H
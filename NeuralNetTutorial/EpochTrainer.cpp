@@ -0,0 +1,170 @@
+#include "EpochTrainer.h"
+
+void EpochTrainerBase::printEpoch(const EpochReport &epoch, ostream &out) {
+	out << "Epoch " << epoch.epoch << ": training error " << epoch.trainError;
+	if (epoch.validationError >= 0.0) out << ", validation error " << epoch.validationError;
+	if (epoch.sparsity > 0.0) out << ", " << 100.0 * epoch.sparsity << "% pruned";
+	out << ", " << epoch.seconds << " secs\n";
+}
+
+/* the validation set is picked before any epoch is shuffled: the tail of the data as it is, or with shuffle on the
+   tail of one extra shuffle, so it is a random subset that stays the same for the whole run. */
+template <typename T>
+BasicEpochTrainer<T>::BasicEpochTrainer(BasicNet<T> &net, const double *samples, uint64_t numSamples, const Options &options)
+	: m_net(net), m_samples(samples), m_options(options), m_numInputs(net.getNumInputs()),
+	  m_sampleSize(net.getNumInputs() + net.getNumOutputs()), m_random(options.seed),
+	  m_publisher(NULL), m_publishEvery(0) {
+	m_options.batchSize = max(1u, m_options.batchSize);
+	m_options.numThreads = max(1u, m_options.numThreads);
+	m_numValidation = uint64_t(numSamples * min(max(m_options.validation, 0.0), 1.0));
+	uint64_t numTrain = numSamples - m_numValidation;
+	if (m_options.shuffle) {
+		m_order.resize(numSamples);
+		for (uint64_t s = 0; s < numSamples; ++s) m_order[s] = s;
+		if (m_numValidation > 0) shuffle(m_order.begin(), m_order.end(), m_random);
+	}
+	m_validationRows = samples + numTrain * m_sampleSize;   // the tail itself, unless it is a shuffled subset
+	if (m_options.shuffle) {
+		m_validation.resize(m_numValidation * m_sampleSize);
+		for (uint64_t v = 0; v < m_numValidation; ++v) {
+			uint64_t s = m_order[numTrain + v];
+			copy(samples + s * m_sampleSize, samples + (s + 1) * m_sampleSize, m_validation.begin() + v * m_sampleSize);
+		}
+		m_validationRows = m_validation.data();
+		m_order.resize(numTrain);
+	}
+	m_trainSamples = numTrain;
+}
+
+/* every epoch goes over the training samples in chunks the size TRAIN always read (a batch, or 64 steps of every
+   worker for the parallel trainer). without shuffle the chunks are the rows where they are, shuffled chunks are
+   gathered into one buffer first, which the telemetry counts as the parse phase. */
+template <typename T>
+typename BasicEpochTrainer<T>::Report BasicEpochTrainer<T>::train(Telemetry *telemetry, ostream *log,
+	vector<double> &inputVals, vector<double> &targetVals, vector<double> &resultVals) {
+	Report report = Report();
+	report.trainSamples = m_trainSamples;
+	report.validationSamples = m_numValidation;
+	bool parallel = m_options.numThreads > 1 || m_options.mode == ParallelTrainerBase::HOGWILD;
+	BasicParallelTrainer<T> trainer(m_net, m_options.numThreads, m_options.mode, m_options.batchSize);
+	uint64_t readSize = parallel ? uint64_t(m_options.batchSize) * m_options.numThreads * 64 : m_options.batchSize;
+	bool keepBest = m_options.patience > 0;
+	unique_ptr<BasicNet<T> > best(keepBest ? new BasicNet<T>(m_net) : NULL);   // the best epoch's weights
+	double bestError = numeric_limits<double>::infinity();
+	unsigned sinceBest = 0;
+	if (telemetry) m_net.setCounters(&telemetry->counters());
+	m_net.takeMeanError();                  // the first epoch's error starts here
+	uint64_t nextPublish = m_publishEvery;
+	if (m_publisher) m_publisher->publish(m_net);
+	chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+	for (unsigned epoch = 1; epoch <= m_options.epochs && m_trainSamples > 0; ++epoch) {
+		if (m_options.shuffle) shuffle(m_order.begin(), m_order.end(), m_random);
+		for (uint64_t start = 0; start < m_trainSamples; start += readSize) {
+			unsigned count = unsigned(min(readSize, m_trainSamples - start));
+			if (telemetry) telemetry->beginBatch();
+			PhaseTimer gatherTimer(m_net.getCounters());
+			const double *rows = m_samples + start * m_sampleSize;
+			if (m_options.shuffle) {
+				m_batch.resize(uint64_t(count) * m_sampleSize);
+				for (unsigned r = 0; r < count; ++r) {
+					const double *row = m_samples + m_order[start + r] * m_sampleSize;
+					copy(row, row + m_sampleSize, m_batch.begin() + uint64_t(r) * m_sampleSize);
+				}
+				rows = m_batch.data();
+			}
+			gatherTimer.mark(TrainingCounters::PARSE);
+			if (parallel) trainer.train(rows, count);
+			else m_net.trainBatch(rows, count);   // feed the batch forward and back propagate it
+			if (telemetry) telemetry->endBatch();
+			report.samples += count;
+			const double *lastSample = rows + uint64_t(count - 1) * m_sampleSize;
+			inputVals.assign(lastSample, lastSample + m_numInputs);
+			targetVals.assign(lastSample + m_numInputs, lastSample + m_sampleSize);
+			if (telemetry && telemetry->due()) {  // report results and metrics every so many samples
+				if (parallel) m_net.feedForward(inputVals); // the workers' replicas saw the samples, not the net itself
+				m_net.getResults(resultVals);
+				telemetry->snapshot(inputVals, resultVals, targetVals, m_net.getRecentAverageError());
+			}
+			if (m_publisher && report.samples >= nextPublish) {   // no worker is running, the weights hold still
+				m_publisher->publish(m_net);
+				nextPublish = (report.samples / m_publishEvery + 1) * m_publishEvery;
+			}
+		}
+		if (m_options.pruneSparsity > 0.0) {
+			double remaining = 1.0 - double(epoch) / m_options.epochs;
+			m_net.pruneToSparsity(m_options.pruneSparsity * (1.0 - remaining * remaining * remaining));
+		}
+		EpochReport epochReport;
+		epochReport.epoch = epoch;
+		epochReport.trainError = m_net.takeMeanError();
+		epochReport.sparsity = m_net.getSparsity();
+		epochReport.validationError = validationError();
+		epochReport.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+		if (log) {
+			if (telemetry) telemetry->finish();  // the queued progress dumps first, they may go to the same console
+			printEpoch(epochReport, *log);
+		}
+		report.epochs = epoch;
+		double error = m_numValidation > 0 ? epochReport.validationError : epochReport.trainError;
+		if (!report.reachedTarget && m_options.targetError > 0.0 && error <= m_options.targetError) {
+			report.reachedTarget = true;
+			report.targetEpoch = epoch;
+			report.targetSeconds = epochReport.seconds;
+			report.targetSamples = report.samples;
+		}
+		if (!keepBest || error < bestError - m_options.minDelta) {
+			bestError = error;
+			report.bestEpoch = epoch;
+			report.bestError = error;
+			report.bestSeconds = epochReport.seconds;
+			sinceBest = 0;
+			if (keepBest) best->copyWeights(m_net);
+		}
+		else if (++sinceBest >= m_options.patience) {
+			report.stoppedEarly = true;
+			break;
+		}
+	}
+	report.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+	bool restored = keepBest && report.bestEpoch > 0 && report.bestEpoch < report.epochs;
+	if (restored) m_net.copyWeights(*best);  // the epochs after the best one only made it worse
+	if (m_options.pruneSparsity > 0.0) m_net.pruneToSparsity(m_options.pruneSparsity);   // if it stopped before the schedule got there
+	if (m_publisher) m_publisher->publish(m_net);
+	if (report.samples > 0) {
+		if (parallel || restored) m_net.feedForward(inputVals);
+		m_net.getResults(resultVals);
+		if (telemetry && NN_TELEMETRY) {     // the metrics file ends with the final numbers
+			telemetry->snapshot(inputVals, resultVals, targetVals, m_net.getRecentAverageError(), true);
+		}
+	}
+	if (telemetry) m_net.setCounters(NULL);
+	return report;
+}
+
+/* scored in chunks, so the scratch inferBatch needs stays small whatever the size of the validation set. */
+template <typename T>
+double BasicEpochTrainer<T>::validationError(void) {
+	if (m_numValidation == 0) return -1.0;
+	const unsigned chunk = 4096;
+	unsigned numOutputs = m_sampleSize - m_numInputs;
+	m_outputs.resize(uint64_t(chunk) * numOutputs);
+	double errorSum = 0.0;
+	for (uint64_t start = 0; start < m_numValidation; start += chunk) {
+		unsigned count = unsigned(min<uint64_t>(chunk, m_numValidation - start));
+		const double *rows = m_validationRows + start * m_sampleSize;
+		m_net.inferBatch(rows, m_sampleSize, count, m_outputs.data(), m_scratch);
+		for (unsigned r = 0; r < count; ++r) {
+			const double *targetVals = rows + uint64_t(r) * m_sampleSize + m_numInputs;
+			double error = 0.0;
+			for (unsigned n = 0; n < numOutputs; ++n) {
+				double delta = targetVals[n] - m_outputs[uint64_t(r) * numOutputs + n];
+				error += delta * delta;
+			}
+			errorSum += sqrt(error / numOutputs);   // RMS, as the nets record it
+		}
+	}
+	return errorSum / m_numValidation;
+}
+
+template class BasicEpochTrainer<double>;
+template class BasicEpochTrainer<float>;
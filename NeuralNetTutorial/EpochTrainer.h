@@ -0,0 +1,86 @@
+#pragma once
+#ifndef EpochTrainer_H
+#define EpochTrainer_H
+#include "Net.h"
+#include "ParallelTrainer.h"
+#include "Model.h"
+#include <random>
+
+/* trains a net for several epochs over a dataset that is already in memory (LearnData::getAllSamples). the samples
+   can be reshuffled every epoch by a seeded generator, so a run can be repeated exactly, and the tail of the first
+   shuffle can be held out as a validation set. after every epoch the validation set is scored with inferBatch (no
+   training, the net is left as it was) and training stops early once that error hasn't improved by minDelta for
+   patience epochs, putting back the weights of the best epoch. with the default options this is exactly the single
+   pass over the file the TRAIN command always made. with a pruning target the net is pruned gradually, at the end
+   of every epoch, along the cubic schedule of Zhu and Gupta: sparsity * (1 - (1 - epoch / epochs)^3), so most
+   weights go early while the net can still recover from it and the last epochs train at the target. */
+class EpochTrainerBase {
+public:
+	struct Options {
+		unsigned epochs;
+		unsigned batchSize;
+		unsigned numThreads;
+		ParallelTrainerBase::Mode mode;
+		bool shuffle;
+		uint32_t seed;
+		double validation;      // fraction of the samples held out, [0..1)
+		unsigned patience;      // epochs without improvement before stopping, 0 never stops early
+		double minDelta;        // the least fall in the error that counts as an improvement
+		double targetError;     // the run reports when the error first got this low, 0 for no target
+		double pruneSparsity;   // the fraction of the weights pruned by the end (Net::pruneToSparsity), 0 prunes nothing
+		Options() : epochs(1), batchSize(1), numThreads(1), mode(ParallelTrainerBase::SYNC), shuffle(false), seed(1),
+			validation(0.0), patience(0), minDelta(0.0), targetError(0.0), pruneSparsity(0.0) {}
+	};
+	struct EpochReport {
+		unsigned epoch;          // from 1
+		double trainError;       // mean RMS error of the samples trained on this epoch
+		double validationError;  // mean RMS error of the validation set after the epoch, -1 without one
+		double sparsity;         // of the net the validation set was scored with
+		double seconds;          // since training began
+	};
+	struct Report {
+		unsigned epochs;         // epochs trained
+		unsigned bestEpoch;      // the one whose weights the net was left with (the last unless it stopped early)
+		double bestError;        // its validation error (its training error without a validation set)
+		double bestSeconds;      // how long training had taken by the end of it
+		bool stoppedEarly;
+		bool reachedTarget;
+		unsigned targetEpoch;    // the first epoch that reached targetError
+		double targetSeconds;    // and how long training had taken by then
+		uint64_t targetSamples;  // samples trained on by then
+		double seconds;
+		uint64_t samples;
+		uint64_t trainSamples, validationSamples;
+	};
+	static void printEpoch(const EpochReport &epoch, ostream &out);
+};
+
+template <typename T>
+class BasicEpochTrainer : public EpochTrainerBase {
+public:
+	// samples are rows of inputs followed by targets, they must stay put while the trainer is used
+	BasicEpochTrainer(BasicNet<T> &net, const double *samples, uint64_t numSamples, const Options &options);
+	// telemetry (may be NULL) gets the net's counters and its snapshots, log (may be NULL) a line per epoch.
+	// inputVals, targetVals and resultVals are left holding the last sample trained on and the net's answer to it
+	Report train(Telemetry *telemetry, ostream *log, vector<double> &inputVals, vector<double> &targetVals, vector<double> &resultVals);
+	double validationError(void);   // of the net as it is now, -1 without a validation set
+	// publishes the net when training starts, after every `every` samples and once it is done (the kept weights)
+	void setPublisher(BasicModelPublisher<T> *publisher, uint64_t every) { m_publisher = publisher; m_publishEvery = max<uint64_t>(1, every); }
+private:
+	BasicNet<T> &m_net;
+	const double *m_samples;
+	Options m_options;
+	unsigned m_numInputs, m_sampleSize;
+	mt19937 m_random;
+	vector<uint64_t> m_order;          // the training samples, in the order of the current epoch
+	vector<double> m_validation;       // the held out rows copied together, if they are shuffled
+	const double *m_validationRows;    // the held out rows
+	uint64_t m_trainSamples, m_numValidation;
+	vector<double> m_batch;            // a shuffled chunk's rows gathered together
+	vector<double> m_outputs;          // inferBatch's answers for the validation set
+	typename BasicNet<T>::Scratch m_scratch;
+	BasicModelPublisher<T> *m_publisher;
+	uint64_t m_publishEvery;
+};
+typedef BasicEpochTrainer<double> EpochTrainer;
+#endif // !EpochTrainer_H
@@ -10,6 +10,18 @@
 #include <sstream>   //for appending numeric type variables to a string stream that can easily convert to string
 #include <ctime>     //for tracking system time (ie time spent on learning from the learning data file).
 #include <algorithm> //gives us access to super efficient algorithms to deal with strings and containers (like a vector)
+#include <cstring>   //memcpy and memcmp, for moving raw bytes in and out of binary files
+#include <cstdio>    //rename(), to swap a finished checkpoint into place
+#include <stdexcept> //runtime_error, thrown when a file can't be read or written
+#include <cstdint>   //fixed width integers (uint32_t, uint64_t) for sizes and binary file layouts
+#include <memory>    //smart pointers (unique_ptr, shared_ptr) that delete what they own
+#include <map>       //sorted key/value container, used for the NAME=value options typed after a command
+#include <unordered_map> //hash table, finds the inference cache's entries by the hash of their inputs
+#include <thread>    //worker threads for the parallel trainer
+#include <mutex>     //locks and condition variables to let those threads wait for each other
+#include <condition_variable>
+#include <chrono>    //high resolution wall clock time, for throughput numbers
+#include <atomic>    //counters and published pointers that several threads read and write without a lock
 using namespace std; //we can use anything from the std namespace without having to scope (std::)
 
 /* trims the left side of any string */
@@ -33,4 +45,19 @@ static inline void cap(string &s) {
 	for (unsigned int i = 0; i < s.size(); ++i) {
 		s.at(i) = toupper(s.at(i));
 	}
+}
+
+/* returns the value of an environment variable, or an empty string if it isn't set. */
+static inline string getEnv(const char *name) {
+#ifdef _MSC_VER
+	char *value = NULL;
+	size_t length = 0;
+	string result;
+	if (_dupenv_s(&value, &length, name) == 0 && value != NULL) result = value;
+	free(value);
+	return result;
+#else
+	const char *value = getenv(name);
+	return value != NULL ? string(value) : string();
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "Inference.h"
+#include <charconv>
+
+/* the longest text one value can take: sign, 17 digits, point, exponent, plus the separator after it. */
+static const unsigned MAX_VALUE_CHARS = 32;
+
+/* writes the shortest text that reads back as exactly value, returns the end of it. */
+static char *formatDouble(char *p, double value) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+	return to_chars(p, p + MAX_VALUE_CHARS, value).ptr;
+#else
+	return p + snprintf(p, MAX_VALUE_CHARS, "%.17g", value);
+#endif
+}
+
+template <typename Model>
+BasicInference<Model>::BasicInference(const Model &net, unsigned batchSize, Format format, ostream &out, unsigned bufferSize)
+	: m_net(net), m_batchSize(max(1u, batchSize)), m_numOutputs(net.getNumOutputs()), m_format(format), m_out(out),
+	  m_buffer(max<uint64_t>(bufferSize, uint64_t(m_numOutputs) * MAX_VALUE_CHARS)), m_buffered(0), m_cache(NULL),
+	  m_outputs(uint64_t(m_batchSize) * m_numOutputs), m_rows(0), m_computeSeconds(0.0), m_begin(chrono::steady_clock::now()) {}
+
+bool InferenceBase::parseFormat(const string &name, Format &format) {
+	string upperName = name;
+	cap(upperName);
+	if (upperName == "TEXT") format = TEXT;
+	else if (upperName == "BINARY") format = BINARY;
+	else return false;
+	return true;
+}
+
+template <typename Model>
+void BasicInference<Model>::score(const double *inputs, unsigned inputStride, unsigned numRows) {
+	for (unsigned start = 0; start < numRows; start += m_batchSize) {
+		unsigned count = min(m_batchSize, numRows - start);
+		chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+		const double *batch = inputs + uint64_t(start) * inputStride;
+		if (m_cache) m_cache->inferBatch(m_net, m_net.getWeightVersion(), batch, inputStride, count, m_outputs.data(), m_scratch, m_cacheBatch);
+		else m_net.inferBatch(batch, inputStride, count, m_outputs.data(), m_scratch);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+		m_latencies.push_back(seconds);
+		m_computeSeconds += seconds;
+		m_rows += count;
+		writeRows(m_outputs.data(), count);
+	}
+}
+
+/* appends the rows to the buffer, writing the buffer out whenever the next row might not fit. */
+template <typename Model>
+void BasicInference<Model>::writeRows(const double *outputs, unsigned numRows) {
+	uint64_t rowBytes = m_format == BINARY ? uint64_t(m_numOutputs) * sizeof(double) : uint64_t(m_numOutputs) * MAX_VALUE_CHARS;
+	for (unsigned r = 0; r < numRows; ++r) {
+		if (m_buffered + rowBytes > m_buffer.size()) flush();
+		const double *row = outputs + uint64_t(r) * m_numOutputs;
+		char *p = &m_buffer[m_buffered];
+		if (m_format == BINARY) {
+			memcpy(p, row, rowBytes);
+			p += rowBytes;
+		}
+		else {
+			for (unsigned n = 0; n < m_numOutputs; ++n) {
+				p = formatDouble(p, row[n]);
+				*p++ = n + 1 < m_numOutputs ? ' ' : '\n';
+			}
+		}
+		m_buffered = unsigned(p - m_buffer.data());
+	}
+}
+
+template <typename Model>
+void BasicInference<Model>::flush(void) {
+	m_out.write(m_buffer.data(), m_buffered);
+	m_buffered = 0;
+	m_out.flush();
+}
+
+/* the latency percentiles come from a sorted copy, so reports can be taken while scoring goes on. */
+template <typename Model>
+InferenceBase::Report BasicInference<Model>::getReport(void) const {
+	Report report;
+	report.rows = m_rows;
+	report.batches = m_latencies.size();
+	report.seconds = chrono::duration<double>(chrono::steady_clock::now() - m_begin).count();
+	report.computeSeconds = m_computeSeconds;
+	report.p50 = report.p99 = 0.0;
+	if (!m_latencies.empty()) {
+		vector<double> sorted(m_latencies);
+		sort(sorted.begin(), sorted.end());
+		report.p50 = sorted[(sorted.size() - 1) / 2];
+		report.p99 = sorted[uint64_t(ceil(0.99 * sorted.size())) - 1];
+	}
+	return report;
+}
+
+template class BasicInference<Net>;
+template class BasicInference<FloatNet>;
+template class BasicInference<QuantizedNet>;
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef Inference_H
+#define Inference_H
+#include "QuantizedNet.h"
+
+class InferenceBase {
+public:
+	enum Format { TEXT, BINARY };
+	struct Report {
+		uint64_t rows;
+		uint64_t batches;
+		double seconds;        // since construction, reading and writing included
+		double computeSeconds; // inside the forward passes only
+		double p50, p99;       // latency of one batch's forward pass, in seconds
+	};
+	static bool parseFormat(const string &name, Format &format); // "text" or "binary", any case
+};
+
+/* scores rows of inputs with a trained model (BasicNet or QuantizedNet), batchSize rows at a time, and writes
+   the outputs to a stream. the outputs are collected in one buffer that is only written out when it is full, as
+   text (one row of numbers per line) or binary (numOutputs little endian doubles per row, nothing else). */
+template <typename Model>
+class BasicInference : public InferenceBase {
+public:
+	BasicInference(const Model &net, unsigned batchSize, Format format, ostream &out, unsigned bufferSize = 1 << 20);
+	void score(const double *inputs, unsigned inputStride, unsigned numRows); // any number of rows, split into batches
+	void flush(void);
+	Report getReport(void) const;
+	// rows found in the cache skip the forward pass (their time is still counted as compute), NULL turns it off
+	void setCache(InferenceCache *cache) { m_cache = cache; }
+private:
+	void writeRows(const double *outputs, unsigned numRows);
+	const Model &m_net;
+	unsigned m_batchSize, m_numOutputs;
+	Format m_format;
+	ostream &m_out;
+	vector<char> m_buffer;        // formatted output waiting to be written
+	unsigned m_buffered;
+	typename Model::Scratch m_scratch; // the forward pass's activations
+	InferenceCache *m_cache;
+	InferenceCache::Batch m_cacheBatch;
+	vector<double> m_outputs;     // one batch of output rows
+	vector<double> m_latencies;   // seconds, one per batch
+	uint64_t m_rows;
+	double m_computeSeconds;
+	chrono::steady_clock::time_point m_begin;
+};
+typedef BasicInference<Net> Inference;
+#endif // !Inference_H
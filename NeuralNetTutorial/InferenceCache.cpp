@@ -0,0 +1,109 @@
+#include "InferenceCache.h"
+
+atomic<uint64_t> InferenceCache::s_versions(0);
+
+/* every shard gets an equal share of the capacity, at least one entry. */
+InferenceCache::InferenceCache(unsigned numInputs, unsigned numOutputs, unsigned capacity, unsigned numShards)
+	: m_numInputs(numInputs), m_numOutputs(numOutputs) {
+	numShards = max(1u, min(numShards, capacity));
+	for (unsigned s = 0; s < numShards; ++s) {
+		unique_ptr<Shard> shard(new Shard);
+		shard->capacity = max(1u, unsigned((uint64_t(capacity) * (s + 1)) / numShards - (uint64_t(capacity) * s) / numShards));
+		shard->size = shard->hand = 0;
+		shard->inputs.resize(uint64_t(shard->capacity) * numInputs);
+		shard->outputs.resize(uint64_t(shard->capacity) * numOutputs);
+		shard->hashes.resize(shard->capacity);
+		shard->versions.resize(shard->capacity);
+		shard->referenced.resize(shard->capacity);
+		shard->slots.reserve(shard->capacity);
+		shard->hits = shard->misses = shard->stale = shard->evictions = 0;
+		m_shards.push_back(move(shard));
+	}
+}
+
+/* the checkpoint checksum of the input bytes, mixed (murmur3's finalizer) so every bit of it depends on every input
+   bit: small whole numbers only differ in the top bits of their doubles, which the checksum alone never moves down. */
+uint64_t InferenceCache::hashInputs(const double *inputs) const {
+	uint64_t hash = computeChecksum(reinterpret_cast<const char *>(inputs), uint64_t(m_numInputs) * sizeof(double));
+	hash = (hash ^ (hash >> 33)) * 0xff51afd7ed558ccdull;
+	hash = (hash ^ (hash >> 33)) * 0xc4ceb9fe1a85ec53ull;
+	return hash ^ (hash >> 33);
+}
+
+/* the hash only finds the entry, the inputs are compared in full. */
+bool InferenceCache::lookup(const double *inputs, uint64_t version, double *outputs) {
+	uint64_t hash = hashInputs(inputs);
+	Shard &shard = shardOf(hash);
+	lock_guard<mutex> lock(shard.lock);
+	unordered_map<uint64_t, unsigned>::const_iterator found = shard.slots.find(hash);
+	if (found == shard.slots.end() || memcmp(&shard.inputs[uint64_t(found->second) * m_numInputs], inputs, m_numInputs * sizeof(double)) != 0) {
+		++shard.misses;
+		return false;
+	}
+	unsigned slot = found->second;
+	if (shard.versions[slot] != version) {
+		++shard.misses;
+		++shard.stale;
+		return false;
+	}
+	shard.referenced[slot] = 1;
+	memcpy(outputs, &shard.outputs[uint64_t(slot) * m_numOutputs], m_numOutputs * sizeof(double));
+	++shard.hits;
+	return true;
+}
+
+/* an entry with the same hash (the same inputs, stale, or another input that collided) is written over in place.
+   otherwise the shard fills up first, then the CLOCK hand sweeps for an entry that wasn't looked up since it last
+   passed: every referenced bit it meets is cleared, so it stops within one turn. */
+void InferenceCache::insert(const double *inputs, uint64_t version, const double *outputs) {
+	uint64_t hash = hashInputs(inputs);
+	Shard &shard = shardOf(hash);
+	lock_guard<mutex> lock(shard.lock);
+	unsigned slot;
+	unordered_map<uint64_t, unsigned>::const_iterator found = shard.slots.find(hash);
+	if (found != shard.slots.end()) slot = found->second;
+	else {
+		if (shard.size < shard.capacity) slot = shard.size++;
+		else {
+			while (shard.referenced[shard.hand]) {
+				shard.referenced[shard.hand] = 0;
+				shard.hand = (shard.hand + 1) % shard.capacity;
+			}
+			slot = shard.hand;
+			shard.hand = (shard.hand + 1) % shard.capacity;
+			shard.slots.erase(shard.hashes[slot]);
+			++shard.evictions;
+		}
+		shard.slots[hash] = slot;
+	}
+	memcpy(&shard.inputs[uint64_t(slot) * m_numInputs], inputs, m_numInputs * sizeof(double));
+	memcpy(&shard.outputs[uint64_t(slot) * m_numOutputs], outputs, m_numOutputs * sizeof(double));
+	shard.hashes[slot] = hash;
+	shard.versions[slot] = version;
+	shard.referenced[slot] = 0;   // earns its bit with its first hit
+}
+
+InferenceCache::Stats InferenceCache::getStats(void) const {
+	Stats stats = { 0, 0, 0, 0, 0, 0 };
+	for (unsigned s = 0; s < m_shards.size(); ++s) {
+		Shard &shard = *m_shards[s];
+		lock_guard<mutex> lock(shard.lock);
+		stats.hits += shard.hits;
+		stats.misses += shard.misses;
+		stats.stale += shard.stale;
+		stats.evictions += shard.evictions;
+		stats.entries += shard.size;
+		stats.capacity += shard.capacity;
+	}
+	return stats;
+}
+
+void InferenceCache::clear(void) {
+	for (unsigned s = 0; s < m_shards.size(); ++s) {
+		Shard &shard = *m_shards[s];
+		lock_guard<mutex> lock(shard.lock);
+		shard.slots.clear();
+		shard.size = shard.hand = 0;
+		fill(shard.referenced.begin(), shard.referenced.end(), uint8_t(0));
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef InferenceCache_H
+#define InferenceCache_H
+#include "Globalfuncs.h"
+#include "Checkpoint.h"
+
+/* remembers the outputs a net gave for the inputs it saw last, so an input that comes round again is answered
+   without a forward pass. every entry is stamped with the weight version it was computed with (Net::getWeightVersion,
+   BasicModel::getWeightVersion, QuantizedNet::getWeightVersion) and only answers a lookup made with that same version:
+   once the weights change nothing has to be flushed, the old entries just stop matching and are written over.
+   versions come from one counter for the whole program, so one cache can serve several nets at once.
+   the capacity is split over shards picked by the hash of the inputs. each shard has its own lock, held only to find
+   or store one entry, and evicts with the CLOCK algorithm: a lookup sets the entry's referenced bit, the hand clears
+   bits as it sweeps and takes the first entry it finds without one. readers on different threads only wait for each
+   other when their inputs land in the same shard at the same moment. */
+class InferenceCache {
+public:
+	struct Stats {
+		uint64_t hits;
+		uint64_t misses;      // stale entries included
+		uint64_t stale;       // misses that found their inputs, stored with weights that have changed since
+		uint64_t evictions;   // entries dropped to make room for new ones
+		uint64_t entries;     // held right now, stale ones included
+		uint64_t capacity;
+	};
+	struct Batch {            // inferBatch's rows that missed, one per calling thread
+		vector<unsigned> rows;
+		vector<double> inputs, outputs;
+	};
+	InferenceCache(unsigned numInputs, unsigned numOutputs, unsigned capacity, unsigned numShards = 16);
+	// true, with the outputs copied, if inputs were last stored with this version
+	bool lookup(const double *inputs, uint64_t version, double *outputs);
+	void insert(const double *inputs, uint64_t version, const double *outputs);
+	// Model::inferBatch through the cache: the rows found are copied, the rest are scored together in one call and stored.
+	// any number of threads can call it at once, each with its own scratch and batch
+	template <class Model>
+	void inferBatch(const Model &model, uint64_t version, const double *inputs, unsigned inputStride, unsigned numRows,
+		double *outputs, typename Model::Scratch &scratch, Batch &batch);
+	Stats getStats(void) const;   // summed over the shards
+	void clear(void);             // drops every entry, the counters are kept
+	unsigned getNumInputs(void) const { return m_numInputs; }
+	unsigned getNumOutputs(void) const { return m_numOutputs; }
+	// a version no weights have had before, for whatever changes them
+	static uint64_t newVersion(void) { return s_versions.fetch_add(1, memory_order_relaxed) + 1; }
+private:
+	struct Shard {
+		mutex lock;
+		unsigned capacity, size, hand;
+		vector<double> inputs, outputs;     // capacity rows of each
+		vector<uint64_t> hashes, versions;
+		vector<uint8_t> referenced;
+		unordered_map<uint64_t, unsigned> slots;   // hash of the inputs to the entry holding them
+		uint64_t hits, misses, stale, evictions;
+	};
+	uint64_t hashInputs(const double *inputs) const;
+	Shard &shardOf(uint64_t hash) { return *m_shards[hash % m_shards.size()]; }
+	unsigned m_numInputs, m_numOutputs;
+	vector<unique_ptr<Shard> > m_shards;
+	static atomic<uint64_t> s_versions;
+};
+
+template <class Model>
+void InferenceCache::inferBatch(const Model &model, uint64_t version, const double *inputs, unsigned inputStride, unsigned numRows,
+	double *outputs, typename Model::Scratch &scratch, Batch &batch) {
+	batch.rows.clear();
+	batch.inputs.clear();
+	for (unsigned r = 0; r < numRows; ++r) {
+		const double *row = inputs + uint64_t(r) * inputStride;
+		if (lookup(row, version, outputs + uint64_t(r) * m_numOutputs)) continue;
+		batch.rows.push_back(r);
+		batch.inputs.insert(batch.inputs.end(), row, row + m_numInputs);
+	}
+	if (batch.rows.empty()) return;
+	unsigned numMissed = unsigned(batch.rows.size());
+	batch.outputs.resize(uint64_t(numMissed) * m_numOutputs);
+	model.inferBatch(batch.inputs.data(), m_numInputs, numMissed, batch.outputs.data(), scratch);
+	for (unsigned m = 0; m < numMissed; ++m) {
+		const double *row = &batch.outputs[uint64_t(m) * m_numOutputs];
+		memcpy(outputs + uint64_t(batch.rows[m]) * m_numOutputs, row, m_numOutputs * sizeof(double));
+		insert(&batch.inputs[uint64_t(m) * m_numInputs], version, row);
+	}
+}
+#endif // !InferenceCache_H
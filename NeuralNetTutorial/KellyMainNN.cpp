@@ -1,6 +1,16 @@
 #include "Globalfuncs.h"
 #include "LearnData.h"
 #include "Net.h"
+#include "Kernels.h"
+#include "ParallelTrainer.h"
+#include "EpochTrainer.h"
+#include "Model.h"
+#include "Sweep.h"
+#include "Inference.h"
+#include "InferenceCache.h"
+#include "QuantizedNet.h"
+#include "SparseNet.h"
+#include "StaticNet.h"
 
 /* nicely displays values stored in a vector data structure to standard output */
 void showVectorVals(string label, vector<double> &v) {
@@ -9,6 +19,15 @@ void showVectorVals(string label, vector<double> &v) {
 	cout << endl;
 }
 
+/* one line of an inference cache's counters. */
+void showCacheStats(const InferenceCache &cache, ostream &out) {
+	InferenceCache::Stats stats = cache.getStats();
+	uint64_t lookups = stats.hits + stats.misses;
+	out << "Inference cache: " << stats.hits << " hits, " << stats.misses << " misses (" << stats.stale << " stale), "
+		<< fixed << setprecision(1) << (lookups ? 100.0 * stats.hits / lookups : 0.0) << defaultfloat << setprecision(6) << "% hit rate, "
+		<< stats.evictions << " evictions, " << stats.entries << " of " << stats.capacity << " entries in use.\n";
+}
+
 /* reformats a string to be passed into the neural network as vectors of values. 
    NOTE: this function reads specific characters in the input strings to fit the 
    data that is present in the training data. therefore this function must be must
@@ -34,47 +53,346 @@ void handleStringInput(const string &s, const string &s2, vector<double> &inputV
 	}
 }
 
+/* splits the NAME=value options typed after a command (ie "TRAIN BATCH=32") into a map. the names are capitalized,
+   the values are kept as typed so file names keep their case. */
+map<string, string> parseOptions(stringstream &command) {
+	map<string, string> options;
+	string word;
+	while (command >> word) {
+		size_t equals = word.find('=');
+		if (equals == string::npos) throw invalid_argument(word);
+		string name = word.substr(0, equals);
+		cap(name);
+		options[name] = word.substr(equals + 1);
+	}
+	return options;
+}
+
+/* returns the value of one option converted to T, or defaultValue if it wasn't given. */
+template <typename T>
+T optionValue(const map<string, string> &options, const string &name, T defaultValue) {
+	map<string, string>::const_iterator it = options.find(name);
+	if (it == options.end()) return defaultValue;
+	stringstream ss(it->second);
+	T value;
+	if (!(ss >> value)) throw invalid_argument(name);
+	return value;
+}
+
+/* the values of a comma separated option (ie "ETA=0.1,0.33") converted to T, or defaultValues if it wasn't given. */
+template <typename T>
+vector<T> optionList(const map<string, string> &options, const string &name, const vector<T> &defaultValues) {
+	map<string, string>::const_iterator it = options.find(name);
+	if (it == options.end()) return defaultValues;
+	vector<T> values;
+	stringstream list(it->second);
+	string word;
+	while (getline(list, word, ',')) {
+		stringstream ss(word);
+		T value;
+		if (!(ss >> value)) throw invalid_argument(name);
+		values.push_back(value);
+	}
+	if (values.empty()) throw invalid_argument(name);
+	return values;
+}
+
+/* the options TRAIN and SWEEP share: how many epochs, the batches, shuffling, the validation split and when to
+   stop. the defaults are the values epochs already holds. */
+void readEpochOptions(const map<string, string> &options, EpochTrainer::Options &epochs) {
+	epochs.epochs = optionValue(options, "EPOCHS", epochs.epochs);
+	epochs.batchSize = optionValue(options, "BATCH", epochs.batchSize);
+	string shuffle = optionValue(options, "SHUFFLE", string(epochs.shuffle ? "ON" : "OFF"));
+	cap(shuffle);
+	epochs.shuffle = shuffle == "ON";
+	epochs.seed = optionValue(options, "SEED", epochs.seed);
+	epochs.validation = optionValue(options, "VALIDATION", epochs.validation);
+	epochs.patience = optionValue(options, "PATIENCE", epochs.patience);
+	epochs.minDelta = optionValue(options, "MINDELTA", epochs.minDelta);
+	epochs.targetError = optionValue(options, "TARGET", epochs.targetError);
+	epochs.pruneSparsity = optionValue(options, "PRUNE", epochs.pruneSparsity);
+	if (epochs.epochs == 0) throw invalid_argument("EPOCHS");
+	if (epochs.batchSize == 0) throw invalid_argument("BATCH");
+	if (shuffle != "ON" && shuffle != "OFF") throw invalid_argument("SHUFFLE");
+	if (!(epochs.validation >= 0.0 && epochs.validation < 1.0)) throw invalid_argument("VALIDATION");
+	if (epochs.minDelta < 0.0) throw invalid_argument("MINDELTA");
+	if (epochs.targetError < 0.0) throw invalid_argument("TARGET");
+	if (!(epochs.pruneSparsity >= 0.0 && epochs.pruneSparsity < 1.0)) throw invalid_argument("PRUNE");
+	if (epochs.patience > 0 && epochs.validation == 0.0) throw invalid_argument("PATIENCE (it needs a validation split)");
+}
+
+/* the optimizer options TRAIN and SWEEP share, on top of the settings config already holds. picking an optimizer
+   without a training rate trains at that optimizer's default rate. */
+void readOptimizerOptions(const map<string, string> &options, NetConfig &config) {
+	string optimizer = optionValue(options, "OPTIMIZER", string(NetConfig::optimizerName(config.optimizer)));
+	if (!NetConfig::parseOptimizer(optimizer, config.optimizer)) throw invalid_argument("OPTIMIZER");
+	if (options.count("OPTIMIZER") > 0) config.eta = NetConfig::defaultEta(config.optimizer);
+	config.eta = optionValue(options, "ETA", config.eta);
+	config.alpha = optionValue(options, "ALPHA", config.alpha);
+	config.beta1 = optionValue(options, "BETA1", config.beta1);
+	config.beta2 = optionValue(options, "BETA2", config.beta2);
+	config.epsilon = optionValue(options, "EPSILON", config.epsilon);
+	if (config.eta <= 0.0) throw invalid_argument("ETA");
+	if (config.alpha < 0.0) throw invalid_argument("ALPHA");
+	if (!(config.beta1 >= 0.0 && config.beta1 < 1.0)) throw invalid_argument("BETA1");
+	if (!(config.beta2 >= 0.0 && config.beta2 < 1.0)) throw invalid_argument("BETA2");
+	if (config.epsilon <= 0.0) throw invalid_argument("EPSILON");
+}
+
+/* the whole data file, read into memory the first time it is asked for (see LearnData::getAllSamples). */
+const double *cachedSamples(LearnData &trainData, uint64_t &numSamples) {
+	chrono::steady_clock::time_point readBegin = chrono::steady_clock::now();
+	const double *samples = trainData.getAllSamples(numSamples);
+	double readSeconds = chrono::duration<double>(chrono::steady_clock::now() - readBegin).count();
+	if (readSeconds >= 0.001) cout << "Read " << numSamples << " samples into memory in " << readSeconds << " secs.\n";
+	return samples;
+}
+
+/* one serving thread of TRAIN's SERVE option: scores the inputs of the samples, 64 rows at a time and starting at
+   row first, with whichever model was published last, until stop is set. models counts every time it picks up a
+   newer one than the one it scored the previous batch with. with a cache (NULL for none), which every serving
+   thread shares, rows already scored by the same weights aren't run through the model again. */
+template <typename T>
+void serveModels(const BasicModelPublisher<T> &publisher, const double *samples, uint64_t numSamples, unsigned sampleSize,
+	uint64_t first, InferenceCache *cache, const atomic<bool> &stop, atomic<uint64_t> &served, atomic<uint64_t> &models) {
+	const unsigned batchSize = 64;
+	typename BasicModel<T>::Workspace workspace;    // this thread's activations, the models are shared
+	InferenceCache::Batch cacheBatch;
+	vector<double> outputs;
+	uint64_t version = 0, row = first % numSamples;
+	while (!stop) {
+		typename BasicModelPublisher<T>::Snapshot model = publisher.acquire();   // held until the batch is scored
+		if (model->getVersion() != version) {
+			version = model->getVersion();
+			++models;
+		}
+		unsigned count = unsigned(min<uint64_t>(batchSize, numSamples - row));
+		outputs.resize(uint64_t(count) * model->getNumOutputs());
+		if (cache) cache->inferBatch(*model, model->getWeightVersion(), samples + row * sampleSize, sampleSize, count, outputs.data(), workspace, cacheBatch);
+		else model->inferBatch(samples + row * sampleSize, sampleSize, count, outputs.data(), workspace);
+		served += count;
+		row = (row + count) % numSamples;
+	}
+}
+
 /* loops until quit is entered, takes user input and interprets it as a choice of options. 
-   the Net object is manipulated if the user enters TRAIN, USE and READ. the read and write functions export weights and
-   deltaweights to a file to set the network. BE CAREFUL not to try and read a file trained with a different topology or
-   the program will call abort() from an assertion failure. */
-void mainMenu(LearnData & trainData, vector<unsigned> & topology, Net & myNet, vector<double> & inputVals, vector<double> & targetVals, vector<double> & resultVals) {
+   the Net object is manipulated if the user enters TRAIN, USE and READ. the read and write functions save weights and
+   deltaweights to a checkpoint file (or the older text format) to set the network. a file trained with a different
+   topology is refused and the network is left as it was. with a cache (NULL for none) USE and TRAIN's serving threads
+   answer inputs the net has already scored with the same weights from it. */
+template <typename T>
+void mainMenu(const string & dataFileName, LearnData & trainData, vector<unsigned> & topology, BasicNet<T> & myNet, vector<double> & inputVals, vector<double> & targetVals, vector<double> & resultVals,
+	InferenceCache *cache) {
 	while (true) {                                            //loops until 'quit' is entered
 		string comChoice;
-		cout << "\nWhat can I do for you today? Commands I understand are as follows:\n(train, use, read, write, quit)\n";
+		cout << "\nWhat can I do for you today? Commands I understand are as follows:\n(train [epochs=N shuffle=on|off seed=N validation=F patience=N mindelta=F target=F batch=N threads=N mode=sync|hogwild\n  optimizer=momentum|nesterov|rmsprop|adam eta=F alpha=F beta1=F beta2=F epsilon=F metrics=file.csv|file.json every=N\n  console=on|off serve=N prune=F],\n sweep [optimizer=name,name.. eta=F,F.. alpha=F,F.. hidden=N-N,N.. seeds=N,N.. smoothing=F threads=N epochs=N .. target=F\n  beta1=F .. as in train],\n scaling [threads=N mode=sync|hogwild batch=N samples=N], use,\n read [file=name], write [file=name format=binary|text], quantize [samples=N],\n prune [sparsity=F|threshold=F levels=F,F.. samples=N], quit)\n";
 		getline(cin, comChoice);
 		trim(comChoice);
-		cap(comChoice);
-		if (comChoice == "TRAIN") {
-			clock_t begin = clock();                          //keeps track of time from the beginning of the program
-			unsigned trainingPass = 0;                        //counter for the number of passes through the data that the program traverses
-			while (!trainData.isEof()) {                      //while the training data hasn't reached the end of file, keep looping
-				++trainingPass;                               //increment counter by 1 each pass
-				if (trainData.getNextInputs(inputVals) != topology.at(0)) 
-					break;                                    //Get next input data, if its not equal to topology of input layer, leave the loop
-				myNet.feedForward(inputVals);                 //feed values from the inputVals vector forward through the network
-				myNet.getResults(resultVals);                 //Collect the net's actual output result.
-				trainData.getTargetOutputs(targetVals);       //get the target outputs from the file and save it in the vector
-				assert(targetVals.size() == topology.back()); //assert that the size of the vector of target values matches the last value in the topology
-				myNet.backProp(targetVals);                   //use the target values to perform back propagation (calculating gradients)
-				if (trainingPass % 500 == 0) {                //print out results and metrics every 500 passes
-					cout << endl << "Pass " << trainingPass;
-					showVectorVals(": Inputs:", inputVals);
-					showVectorVals("Outputs:", resultVals);
-					showVectorVals("Targets:", targetVals);
-					cout << "Net recent average error: " << myNet.getRecentAverageError() << endl;
+		stringstream command(comChoice);                      //the first word is the command, anything after it are options
+		string comWord;
+		command >> comWord;
+		cap(comWord);
+		if (comWord == "TRAIN") {
+			EpochTrainer::Options trainOptions;               //epochs over the data, samples per weight update, worker threads, early stopping
+			NetConfig netConfig = myNet.getConfig();          //the optimizer and its rates, kept by the net after training
+			unsigned every, serveThreads;                     //samples between reports (and published models), threads scoring them
+			string metricsName, console;
+			try {
+				map<string, string> options = parseOptions(command);
+				readEpochOptions(options, trainOptions);
+				readOptimizerOptions(options, netConfig);
+				trainOptions.numThreads = optionValue(options, "THREADS", 1u);
+				every = optionValue(options, "EVERY", 500u);
+				serveThreads = optionValue(options, "SERVE", 0u);
+				metricsName = optionValue(options, "METRICS", string());
+				console = optionValue(options, "CONSOLE", string("ON"));
+				cap(console);
+				if (trainOptions.numThreads == 0) throw invalid_argument("THREADS");
+				if (every == 0) throw invalid_argument("EVERY");
+				if (console != "ON" && console != "OFF") throw invalid_argument("CONSOLE");
+				if (!ParallelTrainerBase::parseMode(optionValue(options, "MODE", string("SYNC")), trainOptions.mode)) throw invalid_argument("MODE");
+			}
+			catch (invalid_argument &i) { cout << "Couldn't understand the option " << i.what() << ", try train epochs=20 shuffle=on seed=7 validation=0.1 patience=3 target=0.05 batch=32 threads=4 mode=sync optimizer=adam eta=0.01\n  metrics=train.csv every=500 console=off serve=2\n"; continue; }
+			myNet.setConfig(netConfig);
+			uint64_t numSamples;                              //the whole data file, read into memory by the first TRAIN (or SWEEP)
+			const double *samples = cachedSamples(trainData, numSamples);
+			Telemetry telemetry(every);                       //the progress reports, written on their own thread
+			if (!metricsName.empty() && !telemetry.openFile(metricsName)) { cout << "Couldn't open " << metricsName << ".\n"; continue; }
+			Telemetry::ConsoleSink consoleSink(cout);
+			if (console == "ON") telemetry.addSink(&consoleSink);
+			BasicEpochTrainer<T> trainer(myNet, samples, numSamples, trainOptions);
+			BasicModelPublisher<T> publisher;                 //with SERVE, the inference threads read the net's latest copy from here
+			atomic<bool> stopServing(false);
+			atomic<uint64_t> served(0), servedModels(0);
+			vector<thread> servers;
+			if (serveThreads > 0 && numSamples > 0) {
+				trainer.setPublisher(&publisher, every);
+				publisher.publish(myNet);                     //so the servers have a model before training starts
+				for (unsigned t = 0; t < serveThreads; ++t) {
+					servers.push_back(thread(serveModels<T>, cref(publisher), samples, numSamples, topology.front() + topology.back(),
+						numSamples * t / serveThreads, cache, cref(stopServing), ref(served), ref(servedModels)));
 				}
 			}
-			clock_t end = clock();                            //time stamp the end of the loop
-			cout << "Total time spent learning: " << double(end - begin) / CLOCKS_PER_SEC << " secs.\n";
+			EpochTrainer::Report report = trainer.train(&telemetry, &cout, inputVals, targetVals, resultVals);
+			stopServing = true;
+			for (unsigned t = 0; t < servers.size(); ++t) servers[t].join();
+			telemetry.finish();
+			if (report.trainSamples == 0) { cout << "There are no samples left to train on.\n"; continue; }
+			cout << "Total time spent learning: " << report.seconds << " secs.\n";
+#if NN_TELEMETRY
+			bool parallel = trainOptions.numThreads > 1 || trainOptions.mode == ParallelTrainerBase::HOGWILD;
+			cout << "Time spent in each phase: parse " << telemetry.phaseSeconds(TrainingCounters::PARSE) << ", forward "
+				<< telemetry.phaseSeconds(TrainingCounters::FORWARD) << ", backward " << telemetry.phaseSeconds(TrainingCounters::BACKWARD)
+				<< ", update " << telemetry.phaseSeconds(TrainingCounters::UPDATE) << " secs" << (parallel ? " (summed over the worker threads).\n" : ".\n");
+#endif
+			if (!servers.empty()) {
+				cout << "Served " << served << " inferences on " << servers.size() << " threads while training (" << served / max(report.seconds, 1e-9)
+					<< " per sec), picking up a newer model " << servedModels << " times of the " << publisher.getPublished() << " published.\n";
+				if (cache) showCacheStats(*cache, cout);
+			}
+			TextSampleReader::Stats readerStats;
+			if (trainData.getReaderStats(readerStats)) {     //only text files are parsed on the reader thread
+				cout << "Time spent waiting for data: " << readerStats.stallSeconds << " secs (" << readerStats.stalls
+					<< " stalls in " << readerStats.batches << " batches).\n";
+			}
 			cout << "\n\n\nFINAL SCORES FROM THE NEURAL NETWORK\n\n";
-			cout << "Passes: " << trainingPass << endl;
+			cout << "Epochs: " << report.epochs << " of " << report.trainSamples << " samples";
+			if (report.validationSamples > 0) cout << " (" << report.validationSamples << " held out for validation)";
+			cout << (report.stoppedEarly ? ", stopped early" : "") << "\n";
+			if (report.bestEpoch < report.epochs) cout << "Kept the weights of epoch " << report.bestEpoch << ", " << (report.validationSamples > 0 ? "validation" : "training") << " error " << report.bestError << "\n";
+			if (trainOptions.targetError > 0.0) {
+				if (report.reachedTarget) cout << "Time to target error " << trainOptions.targetError << ": " << report.targetSeconds << " secs ("
+					<< report.targetSamples << " samples, epoch " << report.targetEpoch << ")\n";
+				else cout << "Target error " << trainOptions.targetError << " not reached, best " << report.bestError << "\n";
+			}
+			else cout << "Time to error " << report.bestError << ": " << report.bestSeconds << " secs (epoch " << report.bestEpoch << ")\n";
 			showVectorVals("Inputs: ", inputVals);
 			showVectorVals("Target Outputs: ", targetVals);
 			showVectorVals("Network Outputs: ", resultVals);
 			cout << "Net recent average error: " << myNet.getRecentAverageError() << endl;
 		}
-		else if (comChoice == "USE") {
+		else if (comWord == "SWEEP") {
+			vector<NetConfig::Optimizer> optimizers;          //every combination of these trains a fresh net
+			vector<double> etas, alphas;
+			NetConfig baseConfig = myNet.getConfig();         //what the others are set to
+			vector<uint32_t> seeds;
+			vector<vector<unsigned> > topologies;
+			unsigned numThreads;
+			EpochTrainer::Options sweepOptions;               //how each of them trains
+			sweepOptions.epochs = 5;
+			sweepOptions.shuffle = true;
+			sweepOptions.validation = 0.1;
+			try {
+				map<string, string> options = parseOptions(command);
+				vector<string> optimizerNames = optionList(options, "OPTIMIZER", vector<string>(1, NetConfig::optimizerName(baseConfig.optimizer)));
+				optimizers.resize(optimizerNames.size());
+				for (unsigned o = 0; o < optimizerNames.size(); ++o) {
+					if (!NetConfig::parseOptimizer(optimizerNames[o], optimizers[o])) throw invalid_argument("OPTIMIZER");
+				}
+				//without a training rate, a chosen optimizer trains at its default one
+				etas = optionList(options, "ETA", options.count("OPTIMIZER") > 0 ? vector<double>() : vector<double>(1, baseConfig.eta));
+				alphas = optionList(options, "ALPHA", vector<double>(1, baseConfig.alpha));
+				seeds = optionList(options, "SEEDS", vector<uint32_t>(1, 1));
+				baseConfig.recentAverageSmoothingFactor = optionValue(options, "SMOOTHING", baseConfig.recentAverageSmoothingFactor);
+				baseConfig.beta1 = optionValue(options, "BETA1", baseConfig.beta1);
+				baseConfig.beta2 = optionValue(options, "BETA2", baseConfig.beta2);
+				baseConfig.epsilon = optionValue(options, "EPSILON", baseConfig.epsilon);
+				vector<unsigned> dataHidden(topology.begin() + 1, topology.end() - 1);
+				vector<string> hiddenList = optionList(options, "HIDDEN", vector<string>(1, dataHidden.empty() ? string("none") : topologyString(dataHidden)));
+				for (unsigned h = 0; h < hiddenList.size(); ++h) {  //the hidden layers of each topology, ie 8-4, the data file decides the rest
+					vector<unsigned> sweepTopology(1, topology.front());
+					stringstream sizes(hiddenList[h]);
+					string size;
+					while (hiddenList[h] != "none" && getline(sizes, size, '-')) {
+						unsigned long value = strtoul(size.c_str(), NULL, 10);
+						if (value == 0) throw invalid_argument("HIDDEN");
+						sweepTopology.push_back(unsigned(value));
+					}
+					sweepTopology.push_back(topology.back());
+					topologies.push_back(sweepTopology);
+				}
+				numThreads = optionValue(options, "THREADS", max(1u, thread::hardware_concurrency()));
+				readEpochOptions(options, sweepOptions);
+				if (numThreads == 0) throw invalid_argument("THREADS");
+				for (unsigned e = 0; e < etas.size(); ++e) if (etas[e] <= 0.0) throw invalid_argument("ETA");
+				for (unsigned a = 0; a < alphas.size(); ++a) if (alphas[a] < 0.0) throw invalid_argument("ALPHA");
+				if (!(baseConfig.beta1 >= 0.0 && baseConfig.beta1 < 1.0)) throw invalid_argument("BETA1");
+				if (!(baseConfig.beta2 >= 0.0 && baseConfig.beta2 < 1.0)) throw invalid_argument("BETA2");
+				if (baseConfig.epsilon <= 0.0) throw invalid_argument("EPSILON");
+			}
+			catch (invalid_argument &i) { cout << "Couldn't understand the option " << i.what() << ", try sweep optimizer=momentum,adam alpha=0,0.55 hidden=4-3,8 seeds=1,2 epochs=5 validation=0.1 threads=8\n"; continue; }
+			uint64_t numSamples;
+			const double *samples = cachedSamples(trainData, numSamples);
+			vector<SweepBase::Config> configs = SweepBase::grid(topologies, optimizers, etas, alphas, baseConfig, seeds);
+			WorkPool pool(min<unsigned>(numThreads, unsigned(configs.size())));
+			chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+			vector<SweepBase::Result> results = BasicSweep<T>::run(configs, samples, numSamples, sweepOptions, pool);
+			double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+			cout << "Trained " << configs.size() << " configurations on " << pool.getNumThreads() << " threads in " << seconds << " secs ("
+				<< pool.getSteals() << " stolen by an idle thread), ranked by " << (sweepOptions.validation > 0.0 ? "validation" : "training") << " error:\n";
+			SweepBase::printRanking(results, sweepOptions.targetError > 0.0, cout);
+		}
+		else if (comWord == "SCALING") {
+			unsigned batchSize, maxThreads, maxSamples;
+			ParallelTrainerBase::Mode mode = ParallelTrainerBase::SYNC;
+			try {
+				map<string, string> options = parseOptions(command);
+				batchSize = max(1u, optionValue(options, "BATCH", 32u));
+				maxThreads = max(1u, optionValue(options, "THREADS", max(1u, thread::hardware_concurrency())));
+				maxSamples = optionValue(options, "SAMPLES", 80000u);
+				if (!ParallelTrainerBase::parseMode(optionValue(options, "MODE", string("SYNC")), mode)) throw invalid_argument("MODE");
+			}
+			catch (invalid_argument &i) { cout << "Couldn't understand the option " << i.what() << ", try scaling threads=8 mode=hogwild batch=32 samples=80000\n"; continue; }
+			LearnData scalingData(dataFileName);              //a fresh read of the data file, so training isn't affected
+			vector<unsigned> scalingTopology;
+			scalingData.getTopology(scalingTopology);
+			if (scalingTopology != topology) { cout << "The data file's topology doesn't match the network anymore.\n"; continue; }
+			const double *samples;
+			unsigned numSamples = scalingData.getNextBatch(samples, maxSamples);
+			BasicParallelTrainer<T>::scalingReport(myNet, samples, numSamples, maxThreads, mode, batchSize, cout);
+		}
+		else if (comWord == "QUANTIZE") {
+			unsigned maxSamples;
+			try { maxSamples = optionValue(parseOptions(command), "SAMPLES", 80000u); }
+			catch (invalid_argument &i) { cout << "Couldn't understand the option " << i.what() << ", try quantize samples=80000\n"; continue; }
+			LearnData quantizeData(dataFileName);             //scored on a fresh read of the data file
+			vector<unsigned> quantizeTopology;
+			quantizeData.getTopology(quantizeTopology);
+			if (quantizeTopology != topology) { cout << "The data file's topology doesn't match the network anymore.\n"; continue; }
+			const double *samples;
+			unsigned numSamples = quantizeData.getNextBatch(samples, maxSamples);
+			QuantizedNet::accuracyReport(myNet, samples, numSamples, cout);
+		}
+		else if (comWord == "PRUNE") {
+			double sparsity, threshold;
+			vector<double> levels;
+			unsigned maxSamples;
+			try {
+				map<string, string> options = parseOptions(command);
+				sparsity = optionValue(options, "SPARSITY", 0.0);
+				threshold = optionValue(options, "THRESHOLD", 0.0);
+				levels = optionList(options, "LEVELS", vector<double>({ 0.0, 0.5, 0.75, 0.9, 0.95 }));
+				maxSamples = optionValue(options, "SAMPLES", 80000u);
+				if (!(sparsity >= 0.0 && sparsity < 1.0)) throw invalid_argument("SPARSITY");
+				if (!(threshold >= 0.0)) throw invalid_argument("THRESHOLD");
+				for (unsigned l = 0; l < levels.size(); ++l) if (!(levels[l] >= 0.0 && levels[l] < 1.0)) throw invalid_argument("LEVELS");
+			}
+			catch (invalid_argument &i) { cout << "Couldn't understand the option " << i.what() << ", try prune sparsity=0.9 or prune levels=0.5,0.9,0.95\n"; continue; }
+			if (sparsity > 0.0 || threshold > 0.0) {        //prunes the net itself, the report is of what it was left with
+				if (sparsity > 0.0) myNet.pruneToSparsity(sparsity);
+				if (threshold > 0.0) myNet.prune(threshold);
+				cout << "Pruned the network to " << 100.0 * myNet.getSparsity() << "% sparsity.\n";
+				levels.assign(1, myNet.getSparsity());
+			}
+			LearnData pruneData(dataFileName);                //scored on a fresh read of the data file
+			vector<unsigned> pruneTopology;
+			pruneData.getTopology(pruneTopology);
+			if (pruneTopology != topology) { cout << "The data file's topology doesn't match the network anymore.\n"; continue; }
+			const double *samples;
+			unsigned numSamples = pruneData.getNextBatch(samples, maxSamples);
+			BasicSparseNet<T>::pruningReport(myNet, samples, numSamples, levels, cout);
+		}
+		else if (comWord == "USE") {
 			string userIn, userOut;
 			cout << "Add the input and output data you'd like to test, please.\n(YOU MUST TYPE in: and then single digit values IN ORDER TO WORK):\n"
 				"in: 1 0 1\nout: 1 0\n";
@@ -82,42 +400,291 @@ void mainMenu(LearnData & trainData, vector<unsigned> & topology, Net & myNet, v
 			getline(cin, userOut);
 			try {
 				handleStringInput(userIn, userOut, inputVals, targetVals);
-				myNet.feedForward(inputVals);
-				myNet.getResults(resultVals);
+				if (inputVals.size() != myNet.getNumInputs()) throw invalid_argument("in:");
+				resultVals.resize(myNet.getNumOutputs());
+				bool cached = cache && cache->lookup(inputVals.data(), myNet.getWeightVersion(), resultVals.data());
+				if (!cached) {
+					myNet.feedForward(inputVals);
+					myNet.getResults(resultVals);
+					if (cache) cache->insert(inputVals.data(), myNet.getWeightVersion(), resultVals.data());
+				}
 				showVectorVals("Inputs: ", inputVals);
-				showVectorVals("Network Outputs: ", resultVals);
+				showVectorVals(cached ? "Network Outputs (cached): " : "Network Outputs: ", resultVals);
 				cout << "Net recent average error: " << myNet.getRecentAverageError() << endl;
+				if (cache) showCacheStats(*cache, cout);
 			}
 			catch (invalid_argument i) { cout << "The arguments you provided could not be converted to integer values\n"; }
 			catch (out_of_range o) { cout << "The arguments you provided could not be converted because they were out of range.\n"; }
 			catch (exception e) { cout << "The arguments you provided caused an error and could not be converted.\n"; }
 		}
-		else if (comChoice == "READ") {
-			myNet.readNet(topology);
+		else if (comWord == "READ") {
+			try {
+				map<string, string> options = parseOptions(command);
+				string fileName = optionValue(options, "FILE", string("learnDataWeights.ckpt"));
+				myNet.readNet(fileName);
+				cout << "Read the network from " << fileName << ".\n";
+			}
+			catch (invalid_argument &i) { cout << "Couldn't understand the option " << i.what() << ", try read file=learnDataWeights.ckpt\n"; }
+			catch (runtime_error &e) { cout << "Couldn't read the network: " << e.what() << ".\n"; }
 		}
-		else if (comChoice == "WRITE") {
-			myNet.writeNet(topology);
+		else if (comWord == "WRITE") {
+			try {
+				map<string, string> options = parseOptions(command);
+				string format = optionValue(options, "FORMAT", string("BINARY"));
+				cap(format);
+				if (format != "BINARY" && format != "TEXT") throw invalid_argument("FORMAT");
+				string fileName = optionValue(options, "FILE", string(format == "TEXT" ? "learnDataWeights.txt" : "learnDataWeights.ckpt"));
+				if (format == "TEXT") myNet.exportText(fileName);
+				else myNet.writeNet(fileName);
+				cout << "Wrote the network to " << fileName << ".\n";
+			}
+			catch (invalid_argument &i) { cout << "Couldn't understand the option " << i.what() << ", try write file=learnDataWeights.ckpt format=binary|text\n"; }
+			catch (runtime_error &e) { cout << "Couldn't write the network: " << e.what() << ".\n"; }
 		}
-		else if (comChoice == "QUIT") { break; }
+		else if (comWord == "QUIT") { break; }
 		else {
-			cout << "Couldn't understand your command. Please enter train, use, read, write, or quit.\n";
+			cout << "Couldn't understand your command. Please enter train, sweep, scaling, use, read, write, quantize, prune, or quit.\n";
 			break;
 		}
 	}
 }
 
+/* scores inputName (a binary dataset, or text rows of numbers from a file or stdin) with model and writes one row of
+   outputs per input row. the throughput and batch latencies are reported on stderr, so the outputs can go to stdout. */
+template <typename Model>
+int scoreInputs(const Model &model, const string &inputName, const string &outputName, unsigned batchSize, InferenceBase::Format format,
+	unsigned cacheSize) {
+	unsigned numInputs = model.getNumInputs();
+	ios::sync_with_stdio(false);                                             //lets cin and cout buffer by themselves
+	ofstream outFile;
+	if (outputName != "-") {
+		outFile.open(outputName.c_str(), ios::binary | ios::trunc);
+		if (!outFile) { cerr << "Couldn't open " << outputName << ".\n"; return 1; }
+	}
+	BasicInference<Model> inference(model, batchSize, format, outputName == "-" ? cout : outFile);
+	unique_ptr<InferenceCache> cache(cacheSize > 0 ? new InferenceCache(numInputs, model.getNumOutputs(), cacheSize) : NULL);
+	inference.setCache(cache.get());
+	LearnData dataset(inputName == "-" ? string() : inputName);
+	if (dataset.isBinary()) {                                                //scored straight out of the mapping
+		vector<unsigned> dataTopology;
+		dataset.getTopology(dataTopology);
+		if (dataTopology.front() != numInputs) { cerr << inputName << " doesn't have " << numInputs << " inputs per row.\n"; return 1; }
+		const double *rows;
+		unsigned numRows;
+		while ((numRows = dataset.getNextBatch(rows, 1 << 16)) > 0) inference.score(rows, dataTopology.front() + dataTopology.back(), numRows);
+	}
+	else {
+		ifstream inFile;
+		if (inputName != "-") {
+			inFile.open(inputName.c_str(), ios::binary);
+			if (!inFile) { cerr << "Couldn't open " << inputName << ".\n"; return 1; }
+		}
+		TextSampleReader reader(inputName == "-" ? cin : inFile, numInputs, 0);
+		const double *rows;
+		unsigned numRows;
+		while ((numRows = reader.next(rows)) > 0) inference.score(rows, numInputs, numRows);
+	}
+	inference.flush();
+	InferenceBase::Report report = inference.getReport();
+	cerr << report.rows << " rows in " << report.seconds << " secs: " << fixed << setprecision(0)
+		<< report.rows / max(report.seconds, 1e-9) << " rows/sec (" << report.rows / max(report.computeSeconds, 1e-9)
+		<< " rows/sec in the forward passes)\n" << setprecision(1) << "batch of " << batchSize << " latency: p50 "
+		<< report.p50 * 1e6 << " us, p99 " << report.p99 * 1e6 << " us over " << report.batches << " batches\n";
+	if (cache) showCacheStats(*cache, cerr);
+	return 0;
+}
+
+/* loads a checkpoint into a net of scalar T, throws runtime_error if it can't. */
+template <typename T>
+void loadCheckpoint(const string &fileName, BasicNet<T> *&net) {
+	vector<unsigned> topology;
+	if (!Net::readTopology(fileName, topology)) throw runtime_error(fileName + " isn't a checkpoint");
+	net = new BasicNet<T>(topology);
+	try { net->readNet(fileName); }
+	catch (...) { delete net; throw; }
+}
+
+/* the infer command: scores a file of inputs with a saved checkpoint, run in double, float or as an int8 model. */
+int infer(int argc, char *argv[]) {
+	vector<string> files;
+	unsigned batchSize, cacheSize;
+	InferenceBase::Format format = InferenceBase::TEXT;
+	string precision;
+	try {
+		stringstream optionWords;
+		for (int a = 2; a < argc; ++a) {
+			if (string(argv[a]).find('=') == string::npos) files.push_back(argv[a]);
+			else optionWords << argv[a] << " ";
+		}
+		map<string, string> options = parseOptions(optionWords);
+		batchSize = optionValue(options, "BATCH", 256u);
+		if (batchSize == 0) throw invalid_argument("BATCH");
+		cacheSize = optionValue(options, "CACHE", 0u);
+		if (!InferenceBase::parseFormat(optionValue(options, "FORMAT", string("TEXT")), format)) throw invalid_argument("FORMAT");
+		precision = optionValue(options, "PRECISION", string("DOUBLE"));
+		cap(precision);
+		if (precision != "DOUBLE" && precision != "FLOAT" && precision != "INT8") throw invalid_argument("PRECISION");
+	}
+	catch (invalid_argument &i) { cerr << "Couldn't understand the option " << i.what() << ".\n"; return 1; }
+	if (files.empty() || files.size() > 3) {
+		cerr << "usage: " << argv[0] << " infer <checkpoint> [input file|-] [output file|-] [batch=N] [format=text|binary] [precision=double|float|int8] [cache=N]\n";
+		return 1;
+	}
+	string inputName = files.size() >= 2 ? files[1] : "-", outputName = files.size() >= 3 ? files[2] : "-";
+	try {
+		if (precision == "FLOAT") {
+			FloatNet *net;
+			loadCheckpoint(files[0], net);
+			unique_ptr<FloatNet> owner(net);
+			return scoreInputs(*net, inputName, outputName, batchSize, format, cacheSize);
+		}
+		Net *net;
+		loadCheckpoint(files[0], net);
+		unique_ptr<Net> owner(net);
+		if (precision == "INT8") return scoreInputs(QuantizedNet(*net), inputName, outputName, batchSize, format, cacheSize);
+		return scoreInputs(*net, inputName, outputName, batchSize, format, cacheSize);
+	}
+	catch (runtime_error &e) { cerr << "Couldn't read the network: " << e.what() << ".\n"; return 1; }
+}
+
+/* times one sample at a time through a model, forward only or forward and back, and returns ns per sample. sum
+   collects the outputs so the compiler can't drop the work. */
+template <typename Model>
+double timeSamples(Model &model, const vector<vector<double> > &inputs, const vector<vector<double> > &targets,
+	unsigned numSamples, bool train, double &sum) {
+	vector<double> resultVals;
+	chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+	for (unsigned s = 0; s < numSamples; ++s) {
+		model.feedForward(inputs[s % inputs.size()]);
+		if (train) model.backProp(targets[s % targets.size()]);
+		model.getResults(resultVals);
+		sum += resultVals[0];
+	}
+	return chrono::duration<double, nano>(chrono::steady_clock::now() - begin).count() / max(1u, numSamples);
+}
+
+/* the latency command: the per sample cost of the dynamic Net against StaticNet<3, 4, 3, 2>, the compile time
+   version of learnData.txt's net. both start from the same weights (a checkpoint of that topology if one is given,
+   the same random draw otherwise) and see the same synthetic 0/1 samples, so they should also end up equal. */
+int latency(int argc, char *argv[]) {
+	typedef StaticNet<3, 4, 3, 2> SmallNet;
+	vector<string> files;
+	unsigned numSamples;
+	try {
+		stringstream optionWords;
+		for (int a = 2; a < argc; ++a) {
+			if (string(argv[a]).find('=') == string::npos) files.push_back(argv[a]);
+			else optionWords << argv[a] << " ";
+		}
+		map<string, string> options = parseOptions(optionWords);
+		numSamples = optionValue(options, "SAMPLES", 1000000u);
+	}
+	catch (invalid_argument &i) { cerr << "Couldn't understand the option " << i.what() << ".\n"; return 1; }
+	if (files.size() > 1) { cerr << "usage: " << argv[0] << " latency [checkpoint] [samples=N]\n"; return 1; }
+	srand(1);
+	Net net(SmallNet::getTopology());
+	srand(1);
+	SmallNet staticNet;                                                      // lives on the stack, nothing allocated
+	if (!files.empty()) {
+		try {
+			net.readNet(files[0]);
+			staticNet.readNet(files[0]);
+		}
+		catch (runtime_error &e) { cerr << "Couldn't read the network: " << e.what() << ".\n"; return 1; }
+	}
+	vector<vector<double> > inputs(1024, vector<double>(SmallNet::getNumInputs())), targets(1024, vector<double>(SmallNet::getNumOutputs()));
+	for (unsigned s = 0; s < inputs.size(); ++s) {
+		for (unsigned i = 0; i < inputs[s].size(); ++i) inputs[s][i] = rand() % 2;
+		for (unsigned n = 0; n < targets[s].size(); ++n) targets[s][n] = rand() % 2;
+	}
+	double sum = 0.0;
+	double netForward = timeSamples(net, inputs, targets, numSamples, false, sum);
+	double staticForward = timeSamples(staticNet, inputs, targets, numSamples, false, sum);
+	double netTrain = timeSamples(net, inputs, targets, numSamples, true, sum);
+	double staticTrain = timeSamples(staticNet, inputs, targets, numSamples, true, sum);
+	vector<double> netResults, staticResults;
+	double largestDelta = 0.0;
+	for (unsigned s = 0; s < inputs.size(); ++s) {
+		net.feedForward(inputs[s]);
+		net.getResults(netResults);
+		staticNet.feedForward(inputs[s]);
+		staticNet.getResults(staticResults);
+		for (unsigned n = 0; n < netResults.size(); ++n) largestDelta = max(largestDelta, fabs(netResults[n] - staticResults[n]));
+	}
+	cout << "3-4-3-2 net, " << numSamples << " samples one at a time (math kernels: " << Kernels::name() << ")\n" << fixed << setprecision(1)
+		<< "  feedForward + getResults:            Net " << netForward << " ns, StaticNet " << staticForward << " ns ("
+		<< netForward / max(staticForward, 1e-9) << "x)\n"
+		<< "  feedForward + backProp + getResults: Net " << netTrain << " ns, StaticNet " << staticTrain << " ns ("
+		<< netTrain / max(staticTrain, 1e-9) << "x)\n";
+	cout.unsetf(ios::fixed);
+	cout << setprecision(6) << "  largest output difference after training: " << largestDelta << (sum == 0.0 ? " " : "") << "\n";
+	return 0;
+}
+
 /* main holds the training data, and makes a single call to mainMenu which encapsulates each function the network is 
-   capable of executing. */
-int main() {
-	LearnData trainData("learnData.txt");                                    //make a stack object for training data, URL for the file name
+   capable of executing. usage:
+     NeuralNetSupervised [data file] [precision=double|float] [activations=name,name..] [cache=N]
+                                                              trains on learnData.txt unless another text or binary file is
+                                                              given. activations names the transfer function of every layer
+                                                              after the input layer (see Activation.h), or of all of them.
+                                                              cache keeps the outputs of the last N inputs USE and TRAIN's
+                                                              serving threads scored (see InferenceCache.h)
+     NeuralNetSupervised convert <text file> <binary file>    writes the binary (memory mapped) version of a text data file
+     NeuralNetSupervised infer <checkpoint> [input] [output] [batch=N] [format=text|binary] [precision=double|float|int8] [cache=N]
+                                                              scores inputs (stdin if - or left out) with a saved net,
+                                                              rows seen before answered from a cache of N entries
+     NeuralNetSupervised latency [checkpoint] [samples=N]     per sample timings of Net against the fixed size StaticNet<3, 4, 3, 2> */
+int main(int argc, char *argv[]) {
+	if (argc >= 2 && string(argv[1]) == "convert") {
+		if (argc != 4) { cout << "usage: " << argv[0] << " convert <text file> <binary file>\n"; return 1; }
+		if (!LearnData::convertToBinary(argv[2], argv[3])) { cout << "Couldn't convert " << argv[2] << " to " << argv[3] << ".\n"; return 1; }
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "infer") return infer(argc, argv);
+	if (argc >= 2 && string(argv[1]) == "latency") return latency(argc, argv);
+	string dataFileName = "learnData.txt", precision = "DOUBLE", activationList = "tanh"; //URL for the training data file, scalar the network trains in, its neurons
+	unsigned cacheSize = 0;                                                  //inputs whose outputs are remembered, 0 for no cache
+	for (int a = 1; a < argc; ++a) {
+		string arg = argv[a], upperArg = arg;
+		cap(upperArg);
+		if (upperArg.compare(0, 10, "PRECISION=") == 0) precision = upperArg.substr(10);
+		else if (upperArg.compare(0, 12, "ACTIVATIONS=") == 0) activationList = arg.substr(12);
+		else if (upperArg.compare(0, 6, "CACHE=") == 0) cacheSize = unsigned(strtoul(arg.c_str() + 6, NULL, 10));
+		else dataFileName = arg;
+	}
+	if (precision != "DOUBLE" && precision != "FLOAT") { cout << "precision must be double or float.\n"; return 1; }
+	LearnData trainData(dataFileName);                                       //make a stack object for training data
 	vector<unsigned> topology;                                               //make a vector of unsigned integers for storing the topology of the network ( ie. topology: 8 6 3 )
 	trainData.getTopology(topology);                                         //get the topology information from the training data file and store it in the topology vector
-	Net myNet(topology);                                                     //create a neural network with the topology from the file
+	vector<Activation::Kind> activations;                                    //the transfer function of each layer after the input layer, or one for all
+	stringstream activationNames(activationList);
+	string activationName;
+	while (getline(activationNames, activationName, ',')) {
+		Activation::Kind kind;
+		if (!Activation::parse(activationName, kind)) { cout << "Unknown activation " << activationName << ", try tanh, fasttanh, sigmoid, relu, leakyrelu or linear.\n"; return 1; }
+		activations.push_back(kind);
+	}
+	if (activations.size() != 1 && activations.size() + 1 != topology.size()) {
+		cout << "activations needs one name, or one for each of the " << topology.size() - 1 << " layers after the input layer.\n";
+		return 1;
+	}
+	unique_ptr<InferenceCache> cache(cacheSize > 0 ? new InferenceCache(topology.front(), topology.back(), cacheSize) : NULL);
 	vector<double> inputVals, targetVals, resultVals;                        //declaring vectors of real numbers to store inputs, target outputs, and resulting outputs from the network
 	cout << "HELLO MY NAME IS beaver AND I AM ALIIIIIIVEEE HAHAHAHAHA DESTROY ALL HUMANS\n"
 		"Lol I'm just a Neural Network Machine Learning algorithm based on supervised learning." 
-		"\nI'll do my best to try and learn something from the input and output data you supplied in the learnData.txt file.";
-	mainMenu(trainData, topology, myNet, inputVals, targetVals, resultVals); //main menu function encapulsates the rest of the program
+		"\nI'll do my best to try and learn something from the input and output data you supplied in the " << dataFileName << " file."
+		"\n(math kernels: " << Kernels::name() << ", set NN_SIMD=scalar|sse2|avx2|avx512 to force one; " << (precision == "FLOAT" ? "float" : "double")
+		<< " precision)\n";
+	if (precision == "FLOAT") {
+		FloatNet myNet(topology);                                            //create a neural network with the topology from the file
+		myNet.setActivations(activations);
+		mainMenu(dataFileName, trainData, topology, myNet, inputVals, targetVals, resultVals, cache.get()); //main menu function encapulsates the rest of the program
+	}
+	else {
+		Net myNet(topology);
+		myNet.setActivations(activations);
+		mainMenu(dataFileName, trainData, topology, myNet, inputVals, targetVals, resultVals, cache.get());
+	}
 	cout << "Press any key to end the program...\n";
 	cin.ignore();
 	return 0;
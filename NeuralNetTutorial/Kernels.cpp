@@ -0,0 +1,803 @@
+#include "Kernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define NN_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(NN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define NN_TARGET(isa) __attribute__((target(isa)))   // lets gcc/clang emit an instruction set the rest of the build doesn't assume
+#else
+#define NN_TARGET(isa)                                 // msvc always accepts the intrinsics
+#endif
+
+/* the kernels compute exactly the operations written, the compiler may not fuse a multiply and an add into one
+   FMA (avx-512 has them). that keeps the rounding of a path the same whichever loop calls it, which is what lets
+   Net::trainBatch reproduce the single sample path. */
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+/* the scalar reference, identical to the loops the layers used to run themselves. */
+static double dotScalar(const double *a, const double *b, unsigned n) {
+	double sum = 0.0;
+	for (unsigned i = 0; i < n; ++i) sum += a[i] * b[i];
+	return sum;
+}
+
+static void axpyScalar(double *y, const double *x, double a, unsigned n) {
+	for (unsigned i = 0; i < n; ++i) y[i] += x[i] * a;
+}
+
+static void updateScalar(double *w, double *dw, const double *x, double a, double b, double alpha, unsigned n) {
+	for (unsigned i = 0; i < n; ++i) {
+		dw[i] = a * x[i] * b + alpha * dw[i];
+		w[i] += dw[i];
+	}
+}
+
+static float dotScalarFloat(const float *a, const float *b, unsigned n) {
+	float sum = 0.0f;
+	for (unsigned i = 0; i < n; ++i) sum += a[i] * b[i];
+	return sum;
+}
+
+static void axpyScalarFloat(float *y, const float *x, float a, unsigned n) {
+	for (unsigned i = 0; i < n; ++i) y[i] += x[i] * a;
+}
+
+static void updateScalarFloat(float *w, float *dw, const float *x, float a, float b, float alpha, unsigned n) {
+	for (unsigned i = 0; i < n; ++i) {
+		dw[i] = a * x[i] * b + alpha * dw[i];
+		w[i] += dw[i];
+	}
+}
+
+static void nesterovScalar(double *w, double *v, const double *step, double alpha, unsigned n) {
+	for (unsigned i = 0; i < n; ++i) {
+		v[i] = alpha * v[i] + step[i];
+		w[i] += alpha * v[i] + step[i];
+	}
+}
+
+static void adaptiveScalar(double *w, double *m, double *s, const double *step, const Kernels::Adaptive &c, unsigned n) {
+	double gradScale = double(c.gradScale), beta1 = double(c.beta1), beta2 = double(c.beta2), rate = double(c.rate), correction = double(c.correction), epsilon = double(c.epsilon);
+	for (unsigned i = 0; i < n; ++i) {
+		double g = step[i] * gradScale;
+		m[i] = beta1 * m[i] + (1 - beta1) * g;
+		s[i] = beta2 * s[i] + (1 - beta2) * g * g;
+		w[i] += rate * m[i] / (sqrt(s[i] * correction) + epsilon);
+	}
+}
+
+static void nesterovScalarFloat(float *w, float *v, const float *step, float alpha, unsigned n) {
+	for (unsigned i = 0; i < n; ++i) {
+		v[i] = alpha * v[i] + step[i];
+		w[i] += alpha * v[i] + step[i];
+	}
+}
+
+static void adaptiveScalarFloat(float *w, float *m, float *s, const float *step, const Kernels::Adaptive &c, unsigned n) {
+	float gradScale = float(c.gradScale), beta1 = float(c.beta1), beta2 = float(c.beta2), rate = float(c.rate), correction = float(c.correction), epsilon = float(c.epsilon);
+	for (unsigned i = 0; i < n; ++i) {
+		float g = step[i] * gradScale;
+		m[i] = beta1 * m[i] + (1 - beta1) * g;
+		s[i] = beta2 * s[i] + (1 - beta2) * g * g;
+		w[i] += rate * m[i] / (sqrt(s[i] * correction) + epsilon);
+	}
+}
+
+static void fastTanhScalar(double *v, unsigned n) {
+	for (unsigned i = 0; i < n; ++i) v[i] = Kernels::fastTanh(v[i]);
+}
+
+static void fastTanhScalarFloat(float *v, unsigned n) {
+	for (unsigned i = 0; i < n; ++i) v[i] = Kernels::fastTanh(v[i]);
+}
+
+/* integer sums are exact, so every int8 path returns the same value. */
+static int32_t dotScalarInt8(const int8_t *a, const int8_t *b, unsigned n) {
+	int32_t sum = 0;
+	for (unsigned i = 0; i < n; ++i) sum += int32_t(a[i]) * int32_t(b[i]);
+	return sum;
+}
+
+#ifdef NN_X86
+/* SSE2, two doubles per register. every x86-64 cpu has it. */
+NN_TARGET("sse2") static double dotSse2(const double *a, const double *b, unsigned n) {
+	__m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+	unsigned i = 0;
+	for (; i + 4 <= n; i += 4) {
+		acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+		acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+	}
+	acc0 = _mm_add_pd(acc0, acc1);
+	double sum = _mm_cvtsd_f64(_mm_add_sd(acc0, _mm_unpackhi_pd(acc0, acc0)));
+	for (; i < n; ++i) sum += a[i] * b[i];
+	return sum;
+}
+
+NN_TARGET("sse2") static void axpySse2(double *y, const double *x, double a, unsigned n) {
+	__m128d va = _mm_set1_pd(a);
+	unsigned i = 0;
+	for (; i + 2 <= n; i += 2) {
+		_mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(_mm_loadu_pd(x + i), va)));
+	}
+	for (; i < n; ++i) y[i] += x[i] * a;
+}
+
+NN_TARGET("sse2") static void updateSse2(double *w, double *dw, const double *x, double a, double b, double alpha, unsigned n) {
+	__m128d va = _mm_set1_pd(a), vb = _mm_set1_pd(b), valpha = _mm_set1_pd(alpha);
+	unsigned i = 0;
+	for (; i + 2 <= n; i += 2) {
+		__m128d d = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(va, _mm_loadu_pd(x + i)), vb), _mm_mul_pd(valpha, _mm_loadu_pd(dw + i)));
+		_mm_storeu_pd(dw + i, d);
+		_mm_storeu_pd(w + i, _mm_add_pd(_mm_loadu_pd(w + i), d));
+	}
+	for (; i < n; ++i) {
+		dw[i] = a * x[i] * b + alpha * dw[i];
+		w[i] += dw[i];
+	}
+}
+
+/* four floats per register. */
+NN_TARGET("sse2") static float dotSse2Float(const float *a, const float *b, unsigned n) {
+	__m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+	unsigned i = 0;
+	for (; i + 8 <= n; i += 8) {
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+	}
+	float lanes[4];
+	_mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+	float sum = (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+	for (; i < n; ++i) sum += a[i] * b[i];
+	return sum;
+}
+
+NN_TARGET("sse2") static void axpySse2Float(float *y, const float *x, float a, unsigned n) {
+	__m128 va = _mm_set1_ps(a);
+	unsigned i = 0;
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(x + i), va)));
+	}
+	for (; i < n; ++i) y[i] += x[i] * a;
+}
+
+NN_TARGET("sse2") static void updateSse2Float(float *w, float *dw, const float *x, float a, float b, float alpha, unsigned n) {
+	__m128 va = _mm_set1_ps(a), vb = _mm_set1_ps(b), valpha = _mm_set1_ps(alpha);
+	unsigned i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 d = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(va, _mm_loadu_ps(x + i)), vb), _mm_mul_ps(valpha, _mm_loadu_ps(dw + i)));
+		_mm_storeu_ps(dw + i, d);
+		_mm_storeu_ps(w + i, _mm_add_ps(_mm_loadu_ps(w + i), d));
+	}
+	for (; i < n; ++i) {
+		dw[i] = a * x[i] * b + alpha * dw[i];
+		w[i] += dw[i];
+	}
+}
+
+NN_TARGET("sse2") static void nesterovSse2(double *w, double *v, const double *step, double alpha, unsigned n) {
+	__m128d valpha = _mm_set1_pd(alpha);
+	unsigned i = 0;
+	for (; i + 2 <= n; i += 2) {
+		__m128d vs = _mm_loadu_pd(step + i);
+		__m128d vv = _mm_add_pd(_mm_mul_pd(valpha, _mm_loadu_pd(v + i)), vs);
+		_mm_storeu_pd(v + i, vv);
+		_mm_storeu_pd(w + i, _mm_add_pd(_mm_loadu_pd(w + i), _mm_add_pd(_mm_mul_pd(valpha, vv), vs)));
+	}
+	for (; i < n; ++i) {
+		v[i] = alpha * v[i] + step[i];
+		w[i] += alpha * v[i] + step[i];
+	}
+}
+
+NN_TARGET("sse2") static void adaptiveSse2(double *w, double *m, double *s, const double *step, const Kernels::Adaptive &c, unsigned n) {
+	double gradScale = double(c.gradScale), beta1 = double(c.beta1), beta2 = double(c.beta2), rate = double(c.rate), correction = double(c.correction), epsilon = double(c.epsilon);
+	__m128d vscale = _mm_set1_pd(gradScale), vbeta1 = _mm_set1_pd(beta1), vbeta2 = _mm_set1_pd(beta2), vrate = _mm_set1_pd(rate);
+	__m128d vone1 = _mm_set1_pd(1 - beta1), vone2 = _mm_set1_pd(1 - beta2), vcorrection = _mm_set1_pd(correction), vepsilon = _mm_set1_pd(epsilon);
+	unsigned i = 0;
+	for (; i + 2 <= n; i += 2) {
+		__m128d g = _mm_mul_pd(_mm_loadu_pd(step + i), vscale);
+		__m128d vm = _mm_add_pd(_mm_mul_pd(vbeta1, _mm_loadu_pd(m + i)), _mm_mul_pd(vone1, g));
+		__m128d vs = _mm_add_pd(_mm_mul_pd(vbeta2, _mm_loadu_pd(s + i)), _mm_mul_pd(_mm_mul_pd(vone2, g), g));
+		_mm_storeu_pd(m + i, vm);
+		_mm_storeu_pd(s + i, vs);
+		__m128d d = _mm_div_pd(_mm_mul_pd(vrate, vm), _mm_add_pd(_mm_sqrt_pd(_mm_mul_pd(vs, vcorrection)), vepsilon));
+		_mm_storeu_pd(w + i, _mm_add_pd(_mm_loadu_pd(w + i), d));
+	}
+	for (; i < n; ++i) {
+		double g = step[i] * gradScale;
+		m[i] = beta1 * m[i] + (1 - beta1) * g;
+		s[i] = beta2 * s[i] + (1 - beta2) * g * g;
+		w[i] += rate * m[i] / (sqrt(s[i] * correction) + epsilon);
+	}
+}
+
+NN_TARGET("sse2") static void nesterovSse2Float(float *w, float *v, const float *step, float alpha, unsigned n) {
+	__m128 valpha = _mm_set1_ps(alpha);
+	unsigned i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 vs = _mm_loadu_ps(step + i);
+		__m128 vv = _mm_add_ps(_mm_mul_ps(valpha, _mm_loadu_ps(v + i)), vs);
+		_mm_storeu_ps(v + i, vv);
+		_mm_storeu_ps(w + i, _mm_add_ps(_mm_loadu_ps(w + i), _mm_add_ps(_mm_mul_ps(valpha, vv), vs)));
+	}
+	for (; i < n; ++i) {
+		v[i] = alpha * v[i] + step[i];
+		w[i] += alpha * v[i] + step[i];
+	}
+}
+
+NN_TARGET("sse2") static void adaptiveSse2Float(float *w, float *m, float *s, const float *step, const Kernels::Adaptive &c, unsigned n) {
+	float gradScale = float(c.gradScale), beta1 = float(c.beta1), beta2 = float(c.beta2), rate = float(c.rate), correction = float(c.correction), epsilon = float(c.epsilon);
+	__m128 vscale = _mm_set1_ps(gradScale), vbeta1 = _mm_set1_ps(beta1), vbeta2 = _mm_set1_ps(beta2), vrate = _mm_set1_ps(rate);
+	__m128 vone1 = _mm_set1_ps(1 - beta1), vone2 = _mm_set1_ps(1 - beta2), vcorrection = _mm_set1_ps(correction), vepsilon = _mm_set1_ps(epsilon);
+	unsigned i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 g = _mm_mul_ps(_mm_loadu_ps(step + i), vscale);
+		__m128 vm = _mm_add_ps(_mm_mul_ps(vbeta1, _mm_loadu_ps(m + i)), _mm_mul_ps(vone1, g));
+		__m128 vs = _mm_add_ps(_mm_mul_ps(vbeta2, _mm_loadu_ps(s + i)), _mm_mul_ps(_mm_mul_ps(vone2, g), g));
+		_mm_storeu_ps(m + i, vm);
+		_mm_storeu_ps(s + i, vs);
+		__m128 d = _mm_div_ps(_mm_mul_ps(vrate, vm), _mm_add_ps(_mm_sqrt_ps(_mm_mul_ps(vs, vcorrection)), vepsilon));
+		_mm_storeu_ps(w + i, _mm_add_ps(_mm_loadu_ps(w + i), d));
+	}
+	for (; i < n; ++i) {
+		float g = step[i] * gradScale;
+		m[i] = beta1 * m[i] + (1 - beta1) * g;
+		s[i] = beta2 * s[i] + (1 - beta2) * g * g;
+		w[i] += rate * m[i] / (sqrt(s[i] * correction) + epsilon);
+	}
+}
+
+NN_TARGET("sse2") static void fastTanhSse2(double *v, unsigned n) {
+	__m128d high = _mm_set1_pd(double(TANH_CLAMP)), low = _mm_set1_pd(double(-TANH_CLAMP));
+	unsigned i = 0;
+	for (; i + 2 <= n; i += 2) {
+		__m128d x = _mm_min_pd(high, _mm_max_pd(low, _mm_loadu_pd(v + i)));
+		__m128d x2 = _mm_mul_pd(x, x);
+		__m128d p = _mm_set1_pd(double(TANH_P[0]));
+		for (unsigned k = 1; k < 7; ++k) p = _mm_add_pd(_mm_mul_pd(p, x2), _mm_set1_pd(double(TANH_P[k])));
+		__m128d q = _mm_set1_pd(double(TANH_Q[0]));
+		for (unsigned k = 1; k < 4; ++k) q = _mm_add_pd(_mm_mul_pd(q, x2), _mm_set1_pd(double(TANH_Q[k])));
+		_mm_storeu_pd(v + i, _mm_div_pd(_mm_mul_pd(p, x), q));
+	}
+	for (; i < n; ++i) v[i] = Kernels::fastTanh(v[i]);
+}
+
+NN_TARGET("sse2") static void fastTanhSse2Float(float *v, unsigned n) {
+	__m128 high = _mm_set1_ps(float(TANH_CLAMP)), low = _mm_set1_ps(float(-TANH_CLAMP));
+	unsigned i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 x = _mm_min_ps(high, _mm_max_ps(low, _mm_loadu_ps(v + i)));
+		__m128 x2 = _mm_mul_ps(x, x);
+		__m128 p = _mm_set1_ps(float(TANH_P[0]));
+		for (unsigned k = 1; k < 7; ++k) p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(float(TANH_P[k])));
+		__m128 q = _mm_set1_ps(float(TANH_Q[0]));
+		for (unsigned k = 1; k < 4; ++k) q = _mm_add_ps(_mm_mul_ps(q, x2), _mm_set1_ps(float(TANH_Q[k])));
+		_mm_storeu_ps(v + i, _mm_div_ps(_mm_mul_ps(p, x), q));
+	}
+	for (; i < n; ++i) v[i] = Kernels::fastTanh(v[i]);
+}
+
+/* sixteen int8 values per register, widened to int16 (sse2 has no sign extending load) and multiplied in pairs
+   into int32 lanes by pmaddwd. */
+NN_TARGET("sse2") static int32_t dotSse2Int8(const int8_t *a, const int8_t *b, unsigned n) {
+	__m128i acc = _mm_setzero_si128(), zero = _mm_setzero_si128();
+	unsigned i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+		__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+		__m128i signA = _mm_cmpgt_epi8(zero, va), signB = _mm_cmpgt_epi8(zero, vb);
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi8(va, signA), _mm_unpacklo_epi8(vb, signB)));
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpackhi_epi8(va, signA), _mm_unpackhi_epi8(vb, signB)));
+	}
+	int32_t lanes[4];
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), acc);
+	int32_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	for (; i < n; ++i) sum += int32_t(a[i]) * int32_t(b[i]);
+	return sum;
+}
+
+/* AVX2, four doubles per register. */
+NN_TARGET("avx2") static double dotAvx2(const double *a, const double *b, unsigned n) {
+	__m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+	unsigned i = 0;
+	for (; i + 8 <= n; i += 8) {
+		acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+		acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+	}
+	acc0 = _mm256_add_pd(acc0, acc1);
+	__m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+	double sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+	for (; i < n; ++i) sum += a[i] * b[i];
+	return sum;
+}
+
+NN_TARGET("avx2") static void axpyAvx2(double *y, const double *x, double a, unsigned n) {
+	__m256d va = _mm256_set1_pd(a);
+	unsigned i = 0;
+	for (; i + 4 <= n; i += 4) {
+		_mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(_mm256_loadu_pd(x + i), va)));
+	}
+	for (; i < n; ++i) y[i] += x[i] * a;
+}
+
+NN_TARGET("avx2") static void updateAvx2(double *w, double *dw, const double *x, double a, double b, double alpha, unsigned n) {
+	__m256d va = _mm256_set1_pd(a), vb = _mm256_set1_pd(b), valpha = _mm256_set1_pd(alpha);
+	unsigned i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256d d = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(va, _mm256_loadu_pd(x + i)), vb),
+			_mm256_mul_pd(valpha, _mm256_loadu_pd(dw + i)));
+		_mm256_storeu_pd(dw + i, d);
+		_mm256_storeu_pd(w + i, _mm256_add_pd(_mm256_loadu_pd(w + i), d));
+	}
+	for (; i < n; ++i) {
+		dw[i] = a * x[i] * b + alpha * dw[i];
+		w[i] += dw[i];
+	}
+}
+
+/* eight floats per register. */
+NN_TARGET("avx2") static float dotAvx2Float(const float *a, const float *b, unsigned n) {
+	__m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+	unsigned i = 0;
+	for (; i + 16 <= n; i += 16) {
+		acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+		acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+	}
+	float lanes[8];
+	_mm256_storeu_ps(lanes, _mm256_add_ps(acc0, acc1));
+	float sum = ((lanes[0] + lanes[4]) + (lanes[2] + lanes[6])) + ((lanes[1] + lanes[5]) + (lanes[3] + lanes[7]));
+	for (; i < n; ++i) sum += a[i] * b[i];
+	return sum;
+}
+
+NN_TARGET("avx2") static void axpyAvx2Float(float *y, const float *x, float a, unsigned n) {
+	__m256 va = _mm256_set1_ps(a);
+	unsigned i = 0;
+	for (; i + 8 <= n; i += 8) {
+		_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_loadu_ps(x + i), va)));
+	}
+	for (; i < n; ++i) y[i] += x[i] * a;
+}
+
+NN_TARGET("avx2") static void updateAvx2Float(float *w, float *dw, const float *x, float a, float b, float alpha, unsigned n) {
+	__m256 va = _mm256_set1_ps(a), vb = _mm256_set1_ps(b), valpha = _mm256_set1_ps(alpha);
+	unsigned i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 d = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(va, _mm256_loadu_ps(x + i)), vb),
+			_mm256_mul_ps(valpha, _mm256_loadu_ps(dw + i)));
+		_mm256_storeu_ps(dw + i, d);
+		_mm256_storeu_ps(w + i, _mm256_add_ps(_mm256_loadu_ps(w + i), d));
+	}
+	for (; i < n; ++i) {
+		dw[i] = a * x[i] * b + alpha * dw[i];
+		w[i] += dw[i];
+	}
+}
+
+NN_TARGET("avx2") static void nesterovAvx2(double *w, double *v, const double *step, double alpha, unsigned n) {
+	__m256d valpha = _mm256_set1_pd(alpha);
+	unsigned i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256d vs = _mm256_loadu_pd(step + i);
+		__m256d vv = _mm256_add_pd(_mm256_mul_pd(valpha, _mm256_loadu_pd(v + i)), vs);
+		_mm256_storeu_pd(v + i, vv);
+		_mm256_storeu_pd(w + i, _mm256_add_pd(_mm256_loadu_pd(w + i), _mm256_add_pd(_mm256_mul_pd(valpha, vv), vs)));
+	}
+	for (; i < n; ++i) {
+		v[i] = alpha * v[i] + step[i];
+		w[i] += alpha * v[i] + step[i];
+	}
+}
+
+NN_TARGET("avx2") static void adaptiveAvx2(double *w, double *m, double *s, const double *step, const Kernels::Adaptive &c, unsigned n) {
+	double gradScale = double(c.gradScale), beta1 = double(c.beta1), beta2 = double(c.beta2), rate = double(c.rate), correction = double(c.correction), epsilon = double(c.epsilon);
+	__m256d vscale = _mm256_set1_pd(gradScale), vbeta1 = _mm256_set1_pd(beta1), vbeta2 = _mm256_set1_pd(beta2), vrate = _mm256_set1_pd(rate);
+	__m256d vone1 = _mm256_set1_pd(1 - beta1), vone2 = _mm256_set1_pd(1 - beta2), vcorrection = _mm256_set1_pd(correction), vepsilon = _mm256_set1_pd(epsilon);
+	unsigned i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256d g = _mm256_mul_pd(_mm256_loadu_pd(step + i), vscale);
+		__m256d vm = _mm256_add_pd(_mm256_mul_pd(vbeta1, _mm256_loadu_pd(m + i)), _mm256_mul_pd(vone1, g));
+		__m256d vs = _mm256_add_pd(_mm256_mul_pd(vbeta2, _mm256_loadu_pd(s + i)), _mm256_mul_pd(_mm256_mul_pd(vone2, g), g));
+		_mm256_storeu_pd(m + i, vm);
+		_mm256_storeu_pd(s + i, vs);
+		__m256d d = _mm256_div_pd(_mm256_mul_pd(vrate, vm), _mm256_add_pd(_mm256_sqrt_pd(_mm256_mul_pd(vs, vcorrection)), vepsilon));
+		_mm256_storeu_pd(w + i, _mm256_add_pd(_mm256_loadu_pd(w + i), d));
+	}
+	for (; i < n; ++i) {
+		double g = step[i] * gradScale;
+		m[i] = beta1 * m[i] + (1 - beta1) * g;
+		s[i] = beta2 * s[i] + (1 - beta2) * g * g;
+		w[i] += rate * m[i] / (sqrt(s[i] * correction) + epsilon);
+	}
+}
+
+NN_TARGET("avx2") static void nesterovAvx2Float(float *w, float *v, const float *step, float alpha, unsigned n) {
+	__m256 valpha = _mm256_set1_ps(alpha);
+	unsigned i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 vs = _mm256_loadu_ps(step + i);
+		__m256 vv = _mm256_add_ps(_mm256_mul_ps(valpha, _mm256_loadu_ps(v + i)), vs);
+		_mm256_storeu_ps(v + i, vv);
+		_mm256_storeu_ps(w + i, _mm256_add_ps(_mm256_loadu_ps(w + i), _mm256_add_ps(_mm256_mul_ps(valpha, vv), vs)));
+	}
+	for (; i < n; ++i) {
+		v[i] = alpha * v[i] + step[i];
+		w[i] += alpha * v[i] + step[i];
+	}
+}
+
+NN_TARGET("avx2") static void adaptiveAvx2Float(float *w, float *m, float *s, const float *step, const Kernels::Adaptive &c, unsigned n) {
+	float gradScale = float(c.gradScale), beta1 = float(c.beta1), beta2 = float(c.beta2), rate = float(c.rate), correction = float(c.correction), epsilon = float(c.epsilon);
+	__m256 vscale = _mm256_set1_ps(gradScale), vbeta1 = _mm256_set1_ps(beta1), vbeta2 = _mm256_set1_ps(beta2), vrate = _mm256_set1_ps(rate);
+	__m256 vone1 = _mm256_set1_ps(1 - beta1), vone2 = _mm256_set1_ps(1 - beta2), vcorrection = _mm256_set1_ps(correction), vepsilon = _mm256_set1_ps(epsilon);
+	unsigned i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 g = _mm256_mul_ps(_mm256_loadu_ps(step + i), vscale);
+		__m256 vm = _mm256_add_ps(_mm256_mul_ps(vbeta1, _mm256_loadu_ps(m + i)), _mm256_mul_ps(vone1, g));
+		__m256 vs = _mm256_add_ps(_mm256_mul_ps(vbeta2, _mm256_loadu_ps(s + i)), _mm256_mul_ps(_mm256_mul_ps(vone2, g), g));
+		_mm256_storeu_ps(m + i, vm);
+		_mm256_storeu_ps(s + i, vs);
+		__m256 d = _mm256_div_ps(_mm256_mul_ps(vrate, vm), _mm256_add_ps(_mm256_sqrt_ps(_mm256_mul_ps(vs, vcorrection)), vepsilon));
+		_mm256_storeu_ps(w + i, _mm256_add_ps(_mm256_loadu_ps(w + i), d));
+	}
+	for (; i < n; ++i) {
+		float g = step[i] * gradScale;
+		m[i] = beta1 * m[i] + (1 - beta1) * g;
+		s[i] = beta2 * s[i] + (1 - beta2) * g * g;
+		w[i] += rate * m[i] / (sqrt(s[i] * correction) + epsilon);
+	}
+}
+
+NN_TARGET("avx2") static void fastTanhAvx2(double *v, unsigned n) {
+	__m256d high = _mm256_set1_pd(double(TANH_CLAMP)), low = _mm256_set1_pd(double(-TANH_CLAMP));
+	unsigned i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256d x = _mm256_min_pd(high, _mm256_max_pd(low, _mm256_loadu_pd(v + i)));
+		__m256d x2 = _mm256_mul_pd(x, x);
+		__m256d p = _mm256_set1_pd(double(TANH_P[0]));
+		for (unsigned k = 1; k < 7; ++k) p = _mm256_add_pd(_mm256_mul_pd(p, x2), _mm256_set1_pd(double(TANH_P[k])));
+		__m256d q = _mm256_set1_pd(double(TANH_Q[0]));
+		for (unsigned k = 1; k < 4; ++k) q = _mm256_add_pd(_mm256_mul_pd(q, x2), _mm256_set1_pd(double(TANH_Q[k])));
+		_mm256_storeu_pd(v + i, _mm256_div_pd(_mm256_mul_pd(p, x), q));
+	}
+	for (; i < n; ++i) v[i] = Kernels::fastTanh(v[i]);
+}
+
+NN_TARGET("avx2") static void fastTanhAvx2Float(float *v, unsigned n) {
+	__m256 high = _mm256_set1_ps(float(TANH_CLAMP)), low = _mm256_set1_ps(float(-TANH_CLAMP));
+	unsigned i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 x = _mm256_min_ps(high, _mm256_max_ps(low, _mm256_loadu_ps(v + i)));
+		__m256 x2 = _mm256_mul_ps(x, x);
+		__m256 p = _mm256_set1_ps(float(TANH_P[0]));
+		for (unsigned k = 1; k < 7; ++k) p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(float(TANH_P[k])));
+		__m256 q = _mm256_set1_ps(float(TANH_Q[0]));
+		for (unsigned k = 1; k < 4; ++k) q = _mm256_add_ps(_mm256_mul_ps(q, x2), _mm256_set1_ps(float(TANH_Q[k])));
+		_mm256_storeu_ps(v + i, _mm256_div_ps(_mm256_mul_ps(p, x), q));
+	}
+	for (; i < n; ++i) v[i] = Kernels::fastTanh(v[i]);
+}
+
+/* sixteen int8 values sign extended to int16 at a time. the avx-512 path uses this one too, byte and word
+   instructions on zmm registers need AVX512BW, which the avx512 path doesn't check for. */
+NN_TARGET("avx2") static int32_t dotAvx2Int8(const int8_t *a, const int8_t *b, unsigned n) {
+	__m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+	unsigned i = 0;
+	for (; i + 32 <= n; i += 32) {
+		__m256i a0 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)));
+		__m256i b0 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+		__m256i a1 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i + 16)));
+		__m256i b1 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i + 16)));
+		acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(a0, b0));
+		acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(a1, b1));
+	}
+	int32_t lanes[8];
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi32(acc0, acc1));
+	int32_t sum = 0;
+	for (unsigned l = 0; l < 8; ++l) sum += lanes[l];
+	for (; i < n; ++i) sum += int32_t(a[i]) * int32_t(b[i]);
+	return sum;
+}
+
+/* AVX-512, eight doubles per register. */
+NN_TARGET("avx512f") static double dotAvx512(const double *a, const double *b, unsigned n) {
+	__m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+	unsigned i = 0;
+	for (; i + 16 <= n; i += 16) {
+		acc0 = _mm512_add_pd(acc0, _mm512_mul_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+		acc1 = _mm512_add_pd(acc1, _mm512_mul_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8)));
+	}
+	double lanes[8];
+	_mm512_storeu_pd(lanes, _mm512_add_pd(acc0, acc1));
+	double sum = ((lanes[0] + lanes[4]) + (lanes[2] + lanes[6])) + ((lanes[1] + lanes[5]) + (lanes[3] + lanes[7]));
+	for (; i < n; ++i) sum += a[i] * b[i];
+	return sum;
+}
+
+NN_TARGET("avx512f") static void axpyAvx512(double *y, const double *x, double a, unsigned n) {
+	__m512d va = _mm512_set1_pd(a);
+	unsigned i = 0;
+	for (; i + 8 <= n; i += 8) {
+		_mm512_storeu_pd(y + i, _mm512_add_pd(_mm512_loadu_pd(y + i), _mm512_mul_pd(_mm512_loadu_pd(x + i), va)));
+	}
+	for (; i < n; ++i) y[i] += x[i] * a;
+}
+
+NN_TARGET("avx512f") static void updateAvx512(double *w, double *dw, const double *x, double a, double b, double alpha, unsigned n) {
+	__m512d va = _mm512_set1_pd(a), vb = _mm512_set1_pd(b), valpha = _mm512_set1_pd(alpha);
+	unsigned i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m512d d = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(va, _mm512_loadu_pd(x + i)), vb),
+			_mm512_mul_pd(valpha, _mm512_loadu_pd(dw + i)));
+		_mm512_storeu_pd(dw + i, d);
+		_mm512_storeu_pd(w + i, _mm512_add_pd(_mm512_loadu_pd(w + i), d));
+	}
+	for (; i < n; ++i) {
+		dw[i] = a * x[i] * b + alpha * dw[i];
+		w[i] += dw[i];
+	}
+}
+
+/* sixteen floats per register. */
+NN_TARGET("avx512f") static float dotAvx512Float(const float *a, const float *b, unsigned n) {
+	__m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+	unsigned i = 0;
+	for (; i + 32 <= n; i += 32) {
+		acc0 = _mm512_add_ps(acc0, _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+		acc1 = _mm512_add_ps(acc1, _mm512_mul_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16)));
+	}
+	float lanes[16];
+	_mm512_storeu_ps(lanes, _mm512_add_ps(acc0, acc1));
+	for (unsigned width = 8; width > 0; width /= 2) {  // pairwise, like the narrower paths
+		for (unsigned l = 0; l < width; ++l) lanes[l] += lanes[l + width];
+	}
+	float sum = lanes[0];
+	for (; i < n; ++i) sum += a[i] * b[i];
+	return sum;
+}
+
+NN_TARGET("avx512f") static void axpyAvx512Float(float *y, const float *x, float a, unsigned n) {
+	__m512 va = _mm512_set1_ps(a);
+	unsigned i = 0;
+	for (; i + 16 <= n; i += 16) {
+		_mm512_storeu_ps(y + i, _mm512_add_ps(_mm512_loadu_ps(y + i), _mm512_mul_ps(_mm512_loadu_ps(x + i), va)));
+	}
+	for (; i < n; ++i) y[i] += x[i] * a;
+}
+
+NN_TARGET("avx512f") static void updateAvx512Float(float *w, float *dw, const float *x, float a, float b, float alpha, unsigned n) {
+	__m512 va = _mm512_set1_ps(a), vb = _mm512_set1_ps(b), valpha = _mm512_set1_ps(alpha);
+	unsigned i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m512 d = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(va, _mm512_loadu_ps(x + i)), vb),
+			_mm512_mul_ps(valpha, _mm512_loadu_ps(dw + i)));
+		_mm512_storeu_ps(dw + i, d);
+		_mm512_storeu_ps(w + i, _mm512_add_ps(_mm512_loadu_ps(w + i), d));
+	}
+	for (; i < n; ++i) {
+		dw[i] = a * x[i] * b + alpha * dw[i];
+		w[i] += dw[i];
+	}
+}
+
+NN_TARGET("avx512f") static void nesterovAvx512(double *w, double *v, const double *step, double alpha, unsigned n) {
+	__m512d valpha = _mm512_set1_pd(alpha);
+	unsigned i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m512d vs = _mm512_loadu_pd(step + i);
+		__m512d vv = _mm512_add_pd(_mm512_mul_pd(valpha, _mm512_loadu_pd(v + i)), vs);
+		_mm512_storeu_pd(v + i, vv);
+		_mm512_storeu_pd(w + i, _mm512_add_pd(_mm512_loadu_pd(w + i), _mm512_add_pd(_mm512_mul_pd(valpha, vv), vs)));
+	}
+	for (; i < n; ++i) {
+		v[i] = alpha * v[i] + step[i];
+		w[i] += alpha * v[i] + step[i];
+	}
+}
+
+NN_TARGET("avx512f") static void adaptiveAvx512(double *w, double *m, double *s, const double *step, const Kernels::Adaptive &c, unsigned n) {
+	double gradScale = double(c.gradScale), beta1 = double(c.beta1), beta2 = double(c.beta2), rate = double(c.rate), correction = double(c.correction), epsilon = double(c.epsilon);
+	__m512d vscale = _mm512_set1_pd(gradScale), vbeta1 = _mm512_set1_pd(beta1), vbeta2 = _mm512_set1_pd(beta2), vrate = _mm512_set1_pd(rate);
+	__m512d vone1 = _mm512_set1_pd(1 - beta1), vone2 = _mm512_set1_pd(1 - beta2), vcorrection = _mm512_set1_pd(correction), vepsilon = _mm512_set1_pd(epsilon);
+	unsigned i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m512d g = _mm512_mul_pd(_mm512_loadu_pd(step + i), vscale);
+		__m512d vm = _mm512_add_pd(_mm512_mul_pd(vbeta1, _mm512_loadu_pd(m + i)), _mm512_mul_pd(vone1, g));
+		__m512d vs = _mm512_add_pd(_mm512_mul_pd(vbeta2, _mm512_loadu_pd(s + i)), _mm512_mul_pd(_mm512_mul_pd(vone2, g), g));
+		_mm512_storeu_pd(m + i, vm);
+		_mm512_storeu_pd(s + i, vs);
+		__m512d d = _mm512_div_pd(_mm512_mul_pd(vrate, vm), _mm512_add_pd(_mm512_sqrt_pd(_mm512_mul_pd(vs, vcorrection)), vepsilon));
+		_mm512_storeu_pd(w + i, _mm512_add_pd(_mm512_loadu_pd(w + i), d));
+	}
+	for (; i < n; ++i) {
+		double g = step[i] * gradScale;
+		m[i] = beta1 * m[i] + (1 - beta1) * g;
+		s[i] = beta2 * s[i] + (1 - beta2) * g * g;
+		w[i] += rate * m[i] / (sqrt(s[i] * correction) + epsilon);
+	}
+}
+
+NN_TARGET("avx512f") static void nesterovAvx512Float(float *w, float *v, const float *step, float alpha, unsigned n) {
+	__m512 valpha = _mm512_set1_ps(alpha);
+	unsigned i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m512 vs = _mm512_loadu_ps(step + i);
+		__m512 vv = _mm512_add_ps(_mm512_mul_ps(valpha, _mm512_loadu_ps(v + i)), vs);
+		_mm512_storeu_ps(v + i, vv);
+		_mm512_storeu_ps(w + i, _mm512_add_ps(_mm512_loadu_ps(w + i), _mm512_add_ps(_mm512_mul_ps(valpha, vv), vs)));
+	}
+	for (; i < n; ++i) {
+		v[i] = alpha * v[i] + step[i];
+		w[i] += alpha * v[i] + step[i];
+	}
+}
+
+NN_TARGET("avx512f") static void adaptiveAvx512Float(float *w, float *m, float *s, const float *step, const Kernels::Adaptive &c, unsigned n) {
+	float gradScale = float(c.gradScale), beta1 = float(c.beta1), beta2 = float(c.beta2), rate = float(c.rate), correction = float(c.correction), epsilon = float(c.epsilon);
+	__m512 vscale = _mm512_set1_ps(gradScale), vbeta1 = _mm512_set1_ps(beta1), vbeta2 = _mm512_set1_ps(beta2), vrate = _mm512_set1_ps(rate);
+	__m512 vone1 = _mm512_set1_ps(1 - beta1), vone2 = _mm512_set1_ps(1 - beta2), vcorrection = _mm512_set1_ps(correction), vepsilon = _mm512_set1_ps(epsilon);
+	unsigned i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m512 g = _mm512_mul_ps(_mm512_loadu_ps(step + i), vscale);
+		__m512 vm = _mm512_add_ps(_mm512_mul_ps(vbeta1, _mm512_loadu_ps(m + i)), _mm512_mul_ps(vone1, g));
+		__m512 vs = _mm512_add_ps(_mm512_mul_ps(vbeta2, _mm512_loadu_ps(s + i)), _mm512_mul_ps(_mm512_mul_ps(vone2, g), g));
+		_mm512_storeu_ps(m + i, vm);
+		_mm512_storeu_ps(s + i, vs);
+		__m512 d = _mm512_div_ps(_mm512_mul_ps(vrate, vm), _mm512_add_ps(_mm512_sqrt_ps(_mm512_mul_ps(vs, vcorrection)), vepsilon));
+		_mm512_storeu_ps(w + i, _mm512_add_ps(_mm512_loadu_ps(w + i), d));
+	}
+	for (; i < n; ++i) {
+		float g = step[i] * gradScale;
+		m[i] = beta1 * m[i] + (1 - beta1) * g;
+		s[i] = beta2 * s[i] + (1 - beta2) * g * g;
+		w[i] += rate * m[i] / (sqrt(s[i] * correction) + epsilon);
+	}
+}
+
+NN_TARGET("avx512f") static void fastTanhAvx512(double *v, unsigned n) {
+	__m512d high = _mm512_set1_pd(double(TANH_CLAMP)), low = _mm512_set1_pd(double(-TANH_CLAMP));
+	unsigned i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m512d x = _mm512_min_pd(high, _mm512_max_pd(low, _mm512_loadu_pd(v + i)));
+		__m512d x2 = _mm512_mul_pd(x, x);
+		__m512d p = _mm512_set1_pd(double(TANH_P[0]));
+		for (unsigned k = 1; k < 7; ++k) p = _mm512_add_pd(_mm512_mul_pd(p, x2), _mm512_set1_pd(double(TANH_P[k])));
+		__m512d q = _mm512_set1_pd(double(TANH_Q[0]));
+		for (unsigned k = 1; k < 4; ++k) q = _mm512_add_pd(_mm512_mul_pd(q, x2), _mm512_set1_pd(double(TANH_Q[k])));
+		_mm512_storeu_pd(v + i, _mm512_div_pd(_mm512_mul_pd(p, x), q));
+	}
+	for (; i < n; ++i) v[i] = Kernels::fastTanh(v[i]);
+}
+
+NN_TARGET("avx512f") static void fastTanhAvx512Float(float *v, unsigned n) {
+	__m512 high = _mm512_set1_ps(float(TANH_CLAMP)), low = _mm512_set1_ps(float(-TANH_CLAMP));
+	unsigned i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m512 x = _mm512_min_ps(high, _mm512_max_ps(low, _mm512_loadu_ps(v + i)));
+		__m512 x2 = _mm512_mul_ps(x, x);
+		__m512 p = _mm512_set1_ps(float(TANH_P[0]));
+		for (unsigned k = 1; k < 7; ++k) p = _mm512_add_ps(_mm512_mul_ps(p, x2), _mm512_set1_ps(float(TANH_P[k])));
+		__m512 q = _mm512_set1_ps(float(TANH_Q[0]));
+		for (unsigned k = 1; k < 4; ++k) q = _mm512_add_ps(_mm512_mul_ps(q, x2), _mm512_set1_ps(float(TANH_Q[k])));
+		_mm512_storeu_ps(v + i, _mm512_div_ps(_mm512_mul_ps(p, x), q));
+	}
+	for (; i < n; ++i) v[i] = Kernels::fastTanh(v[i]);
+}
+
+/* asks the cpu (and the os, which has to save the wider registers) whether an instruction set is usable. */
+static bool cpuHas(const string &path) {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+	bool ymm = (xcr0 & 0x6) == 0x6, zmm = (xcr0 & 0xe6) == 0xe6;
+	int leaf7[4] = { 0, 0, 0, 0 };
+	if (maxLeaf >= 7) __cpuidex(leaf7, 7, 0);
+	if (path == "sse2") return sse2;
+	if (path == "avx2") return ymm && (leaf7[1] & (1 << 5)) != 0;
+	if (path == "avx512") return zmm && (leaf7[1] & (1 << 16)) != 0;
+	return false;
+#else
+	__builtin_cpu_init();
+	if (path == "sse2") return __builtin_cpu_supports("sse2");
+	if (path == "avx2") return __builtin_cpu_supports("avx2");
+	if (path == "avx512") return __builtin_cpu_supports("avx512f");
+	return false;
+#endif
+}
+#endif // NN_X86
+
+Kernels::DotFunc Kernels::m_dot = dotScalar;
+Kernels::AxpyFunc Kernels::m_axpy = axpyScalar;
+Kernels::UpdateFunc Kernels::m_update = updateScalar;
+Kernels::DotFloatFunc Kernels::m_dotFloat = dotScalarFloat;
+Kernels::AxpyFloatFunc Kernels::m_axpyFloat = axpyScalarFloat;
+Kernels::UpdateFloatFunc Kernels::m_updateFloat = updateScalarFloat;
+Kernels::DotInt8Func Kernels::m_dotInt8 = dotScalarInt8;
+Kernels::NesterovFunc Kernels::m_nesterov = nesterovScalar;
+Kernels::AdaptiveFunc Kernels::m_adaptive = adaptiveScalar;
+Kernels::NesterovFloatFunc Kernels::m_nesterovFloat = nesterovScalarFloat;
+Kernels::AdaptiveFloatFunc Kernels::m_adaptiveFloat = adaptiveScalarFloat;
+Kernels::FastTanhFunc Kernels::m_fastTanh = fastTanhScalar;
+Kernels::FastTanhFloatFunc Kernels::m_fastTanhFloat = fastTanhScalarFloat;
+const char *Kernels::m_name = "scalar";
+
+const vector<string> &Kernels::paths(void) {
+#ifdef NN_X86
+	static const vector<string> all = { "scalar", "sse2", "avx2", "avx512" };
+#else
+	static const vector<string> all = { "scalar" };
+#endif
+	return all;
+}
+
+bool Kernels::isSupported(const string &path) {
+	if (path == "scalar") return true;
+#ifdef NN_X86
+	return cpuHas(path);
+#else
+	return false;
+#endif
+}
+
+bool Kernels::select(const string &path) {
+	if (!isSupported(path)) return false;
+	if (path == "scalar") {
+		m_dot = dotScalar; m_axpy = axpyScalar; m_update = updateScalar;
+		m_dotFloat = dotScalarFloat; m_axpyFloat = axpyScalarFloat; m_updateFloat = updateScalarFloat;
+		m_dotInt8 = dotScalarInt8; m_name = "scalar";
+		m_nesterov = nesterovScalar; m_adaptive = adaptiveScalar; m_nesterovFloat = nesterovScalarFloat; m_adaptiveFloat = adaptiveScalarFloat;
+		m_fastTanh = fastTanhScalar; m_fastTanhFloat = fastTanhScalarFloat;
+	}
+#ifdef NN_X86
+	else if (path == "sse2") {
+		m_dot = dotSse2; m_axpy = axpySse2; m_update = updateSse2;
+		m_dotFloat = dotSse2Float; m_axpyFloat = axpySse2Float; m_updateFloat = updateSse2Float;
+		m_dotInt8 = dotSse2Int8; m_name = "sse2";
+		m_nesterov = nesterovSse2; m_adaptive = adaptiveSse2; m_nesterovFloat = nesterovSse2Float; m_adaptiveFloat = adaptiveSse2Float;
+		m_fastTanh = fastTanhSse2; m_fastTanhFloat = fastTanhSse2Float;
+	}
+	else if (path == "avx2") {
+		m_dot = dotAvx2; m_axpy = axpyAvx2; m_update = updateAvx2;
+		m_dotFloat = dotAvx2Float; m_axpyFloat = axpyAvx2Float; m_updateFloat = updateAvx2Float;
+		m_dotInt8 = dotAvx2Int8; m_name = "avx2";
+		m_nesterov = nesterovAvx2; m_adaptive = adaptiveAvx2; m_nesterovFloat = nesterovAvx2Float; m_adaptiveFloat = adaptiveAvx2Float;
+		m_fastTanh = fastTanhAvx2; m_fastTanhFloat = fastTanhAvx2Float;
+	}
+	else if (path == "avx512") {
+		m_dot = dotAvx512; m_axpy = axpyAvx512; m_update = updateAvx512;
+		m_dotFloat = dotAvx512Float; m_axpyFloat = axpyAvx512Float; m_updateFloat = updateAvx512Float;
+		m_dotInt8 = dotAvx2Int8; m_name = "avx512";
+		m_nesterov = nesterovAvx512; m_adaptive = adaptiveAvx512; m_nesterovFloat = nesterovAvx512Float; m_adaptiveFloat = adaptiveAvx512Float;
+		m_fastTanh = fastTanhAvx512; m_fastTanhFloat = fastTanhAvx512Float;
+	}
+#endif
+	return true;
+}
+
+/* runs before main: honours NN_SIMD if it names a usable path, otherwise takes the widest one the cpu has. */
+static bool selectAtStartup() {
+	string forced = getEnv("NN_SIMD");
+	if (!forced.empty() && Kernels::select(forced)) return true;
+	if (!forced.empty()) cerr << "NN_SIMD=" << forced << " is not available on this cpu, picking automatically.\n";
+	const vector<string> &all = Kernels::paths();
+	for (unsigned p = all.size(); p-- > 0;) {
+		if (Kernels::select(all[p])) return true;
+	}
+	return false;
+}
+static bool kernelsSelected = selectAtStartup();
@@ -0,0 +1,96 @@
+#pragma once
+#ifndef Kernels_H
+#define Kernels_H
+#include "Globalfuncs.h"
+using namespace std;
+
+/* the inner loops of the network (forward dot product, sumDOW, the momentum weight update, the other
+   optimizers' updates and a fast tanh), with
+   one implementation per instruction set and scalar type (double and float, plus an int8 dot product for
+   quantized models). the fastest path the cpu supports is picked once at startup through CPUID; setting the
+   NN_SIMD environment variable to scalar, sse2, avx2 or avx512 forces a specific path. */
+class Kernels {
+public:
+	typedef double (*DotFunc)(const double *a, const double *b, unsigned n);
+	typedef void (*AxpyFunc)(double *y, const double *x, double a, unsigned n);
+	typedef void (*UpdateFunc)(double *w, double *dw, const double *x, double a, double b, double alpha, unsigned n);
+	typedef float (*DotFloatFunc)(const float *a, const float *b, unsigned n);
+	typedef void (*AxpyFloatFunc)(float *y, const float *x, float a, unsigned n);
+	typedef void (*UpdateFloatFunc)(float *w, float *dw, const float *x, float a, float b, float alpha, unsigned n);
+	typedef int32_t (*DotInt8Func)(const int8_t *a, const int8_t *b, unsigned n);
+	struct Adaptive {          // the constants of one RMSProp or Adam update, see adaptive
+		double gradScale, beta1, beta2, rate, correction, epsilon;
+	};
+	typedef void (*NesterovFunc)(double *w, double *v, const double *step, double alpha, unsigned n);
+	typedef void (*AdaptiveFunc)(double *w, double *m, double *s, const double *step, const Adaptive &c, unsigned n);
+	typedef void (*NesterovFloatFunc)(float *w, float *v, const float *step, float alpha, unsigned n);
+	typedef void (*AdaptiveFloatFunc)(float *w, float *m, float *s, const float *step, const Adaptive &c, unsigned n);
+	typedef void (*FastTanhFunc)(double *v, unsigned n);
+	typedef void (*FastTanhFloatFunc)(float *v, unsigned n);
+
+	// returns the sum of a[i] * b[i]
+	static double dot(const double *a, const double *b, unsigned n) { return m_dot(a, b, n); }
+	static float dot(const float *a, const float *b, unsigned n) { return m_dotFloat(a, b, n); }
+	static int32_t dot(const int8_t *a, const int8_t *b, unsigned n) { return m_dotInt8(a, b, n); } // exact, no overflow below 2^17 values
+	// y[i] += x[i] * a
+	static void axpy(double *y, const double *x, double a, unsigned n) { m_axpy(y, x, a, n); }
+	static void axpy(float *y, const float *x, float a, unsigned n) { m_axpyFloat(y, x, a, n); }
+	// dw[i] = a * x[i] * b + alpha * dw[i], then w[i] += dw[i]
+	static void update(double *w, double *dw, const double *x, double a, double b, double alpha, unsigned n) { m_update(w, dw, x, a, b, alpha, n); }
+	static void update(float *w, float *dw, const float *x, float a, float b, float alpha, unsigned n) { m_updateFloat(w, dw, x, a, b, alpha, n); }
+
+	/* the optimizer updates (see NetConfig), each one pass over a whole layer's weights and state. step holds the
+	   weight changes plain gradient descent would make (eta times the gradient). */
+	// v[i] = alpha * v[i] + step[i], then w[i] += alpha * v[i] + step[i]
+	static void nesterov(double *w, double *v, const double *step, double alpha, unsigned n) { m_nesterov(w, v, step, alpha, n); }
+	static void nesterov(float *w, float *v, const float *step, float alpha, unsigned n) { m_nesterovFloat(w, v, step, alpha, n); }
+	// g = step[i] * gradScale, m[i] = beta1 * m[i] + (1 - beta1) * g, s[i] = beta2 * s[i] + (1 - beta2) * g * g,
+	// then w[i] += rate * m[i] / (sqrt(s[i] * correction) + epsilon)
+	static void adaptive(double *w, double *m, double *s, const double *step, const Adaptive &c, unsigned n) { m_adaptive(w, m, s, step, c, n); }
+	static void adaptive(float *w, float *m, float *s, const float *step, const Adaptive &c, unsigned n) { m_adaptiveFloat(w, m, s, step, c, n); }
+	// v[i] = tanh(v[i]) to within 4e-7 (see fastTanh(x) below), the whole array at once
+	static void fastTanh(double *v, unsigned n) { m_fastTanh(v, n); }
+	static void fastTanh(float *v, unsigned n) { m_fastTanhFloat(v, n); }
+	template <typename T> static T fastTanh(T x);   // one value, inline: no dispatch, and what every path computes per value
+
+	static bool select(const string &path);   // switches to the named path, false if it is unknown or unsupported
+	static bool isSupported(const string &path);
+	static const char *name(void) { return m_name; }
+	static const vector<string> &paths(void); // every path this build knows about, slowest first
+private:
+	static DotFunc m_dot;
+	static AxpyFunc m_axpy;
+	static UpdateFunc m_update;
+	static DotFloatFunc m_dotFloat;
+	static AxpyFloatFunc m_axpyFloat;
+	static UpdateFloatFunc m_updateFloat;
+	static DotInt8Func m_dotInt8;
+	static NesterovFunc m_nesterov;
+	static AdaptiveFunc m_adaptive;
+	static NesterovFloatFunc m_nesterovFloat;
+	static AdaptiveFloatFunc m_adaptiveFloat;
+	static FastTanhFunc m_fastTanh;
+	static FastTanhFloatFunc m_fastTanhFloat;
+	static const char *m_name;
+};
+
+/* fastTanh: the rational approximation of tanh Eigen uses, an odd polynomial of degree 13 over an even one of
+   degree 6 in x, with x first clamped to the range outside of which tanh rounds to +-1 (NaN isn't, it stays NaN like
+   tanh's, as it does through the vector versions' max and min). horner's rule in x^2, in the same order in every
+   version, so every instruction set gives the same results as this one. */
+static const double TANH_CLAMP = 7.90531110763549805;
+static const double TANH_P[7] = { -2.76076847742355e-16, 2.00018790482477e-13, -8.60467152213735e-11, 5.12229709037114e-08,
+	1.48572235717979e-05, 6.37261928875436e-04, 4.89352455891786e-03 };   // the coefficients of x^13 down to x
+static const double TANH_Q[4] = { 1.19825839466702e-06, 1.18534705686654e-04, 2.26843463243900e-03, 4.89352518554385e-03 }; // x^6 down to 1
+
+template <typename T>
+inline T Kernels::fastTanh(T x) {
+	x = x < T(-TANH_CLAMP) ? T(-TANH_CLAMP) : x > T(TANH_CLAMP) ? T(TANH_CLAMP) : x;
+	T x2 = x * x;
+	T p = T(TANH_P[0]);
+	for (unsigned i = 1; i < 7; ++i) p = p * x2 + T(TANH_P[i]);
+	T q = T(TANH_Q[0]);
+	for (unsigned i = 1; i < 4; ++i) q = q * x2 + T(TANH_Q[i]);
+	return p * x / q;
+}
+#endif // !Kernels_H
@@ -0,0 +1,189 @@
+#include "Globalfuncs.h"
+#include "Kernels.h"
+#include <random>
+#include <limits>
+
+/* the kernel test (KernelsTest, run by ctest in the CMake build). every path the cpu supports has to give what the
+   scalar path gives for dot, axpy, update, nesterov and adaptive in double and float and for the int8 dot, over
+   every length from 0 to maxLength (so every vector body, tail and remainder runs) starting at each offset below
+   alignment. the int8 dot has to match exactly, the rest to within the rounding of a different summation order.
+   fastTanh has to match the inline Kernels::fastTanh(x) bit for bit and stay within maxTanhError of tanh.
+   prints one line per path and exits with 1 if any of them failed. */
+
+static const unsigned maxLength = 70, maxOffset = 3;
+static const double maxTanhError = 4e-7;   // what Kernels.h promises
+
+/* adaptive as RMSProp calls it (no first moment, no correction) and as Adam does on its third step. */
+static const Kernels::Adaptive adaptiveCases[] = {
+	{ 1.0 / 0.15, 0.0, 0.9, -0.01, 1.0, 1e-8 },
+	{ 1.0 / 0.15, 0.9, 0.999, -0.01, 1.0 / (1.0 - 0.999 * 0.999 * 0.999), 1e-3 }
+};
+
+/* what one path gave for every case, in the order runCases makes them. each value comes with the size of the sums
+   it took, so a dot product of large terms that cancel isn't held to the precision of its small result. */
+struct Results {
+	vector<double> values, scales;
+	vector<int32_t> exact;
+	void add(double value, double scale) { values.push_back(value); scales.push_back(scale); }
+	template <typename T> void addAll(const vector<T> &array, double scale) { for (unsigned i = 0; i < array.size(); ++i) add(double(array[i]), scale); }
+};
+
+template <typename T>
+static void runCases(const vector<T> &a, const vector<T> &b, const vector<T> &c, Results &results) {
+	const T alpha = T(0.9), eta = T(0.15);
+	vector<T> w(a.size()), dw(a.size()), s(a.size()), squares(a.size());
+	for (unsigned i = 0; i < s.size(); ++i) s[i] = T(0.5) + c[i] * c[i];   // squared gradient averages can't be negative
+	for (unsigned offset = 0; offset <= maxOffset; ++offset) {
+		for (unsigned n = 0; n <= maxLength; ++n) {
+			double scale = 0.0;
+			for (unsigned i = 0; i < n; ++i) scale += fabs(double(a[offset + i]) * double(b[offset + i]));
+			results.add(double(Kernels::dot(&a[offset], &b[offset], n)), max(scale, 1.0));
+			w = c;
+			Kernels::axpy(&w[offset], &a[offset], T(-0.75), n);
+			results.addAll(w, 1.0);   // outside [offset, offset + n) too
+			w = c;
+			dw = b;
+			Kernels::update(&w[offset], &dw[offset], &a[offset], eta, T(-1.25), alpha, n);
+			results.addAll(w, 2.0);
+			results.addAll(dw, 2.0);
+			w = c;
+			dw = b;
+			Kernels::nesterov(&w[offset], &dw[offset], &a[offset], alpha, n);
+			results.addAll(w, 4.0);
+			results.addAll(dw, 2.0);
+			for (unsigned k = 0; k < sizeof(adaptiveCases) / sizeof(adaptiveCases[0]); ++k) {
+				w = c;
+				dw = b;
+				squares = s;
+				Kernels::adaptive(&w[offset], &dw[offset], &squares[offset], &a[offset], adaptiveCases[k], n);
+				results.addAll(w, 2.0);
+				results.addAll(dw, 8.0);
+				results.addAll(squares, 64.0);
+			}
+		}
+	}
+}
+
+static void runInt8Cases(const vector<int8_t> &a, const vector<int8_t> &b, Results &results) {
+	for (unsigned offset = 0; offset <= maxOffset; ++offset) {
+		for (unsigned n = 0; n <= maxLength; ++n) results.exact.push_back(Kernels::dot(&a[offset], &b[offset], n));
+	}
+}
+
+/* zeros of both signs, NaN, the infinities, the clamp and the values either side of it, then [-20, 20] in steps of
+   1/256. the special values come first, so the short lengths run them through the tails as well. */
+template <typename T>
+static vector<T> tanhInputs(void) {
+	const T clamp = T(TANH_CLAMP), infinity = numeric_limits<T>::infinity();
+	vector<T> inputs = { T(0), -T(0), numeric_limits<T>::quiet_NaN(), -numeric_limits<T>::quiet_NaN(), infinity, -infinity,
+		clamp, -clamp, nextafter(clamp, T(0)), nextafter(-clamp, T(0)), nextafter(clamp, infinity), nextafter(-clamp, -infinity),
+		numeric_limits<T>::denorm_min(), -numeric_limits<T>::min() };
+	for (int i = -20 * 256; i <= 20 * 256; ++i) inputs.push_back(T(i) / T(256));
+	return inputs;
+}
+
+/* the number of values where the array fastTanh, over every length up to maxLength and over the whole array, from
+   each offset, isn't bit for bit the inline Kernels::fastTanh(x) (which the scalar path runs) or writes outside
+   its range, plus the inputs whose result is further than maxTanhError from tanh. NaN only has to stay NaN. */
+template <typename T>
+static unsigned countTanhMismatches(const char *what, const vector<T> &inputs) {
+	unsigned mismatches = 0;
+	for (unsigned offset = 0; offset <= maxOffset; ++offset) {
+		for (unsigned n = 0; n <= maxLength + 1; ++n) {
+			unsigned length = n <= maxLength ? n : unsigned(inputs.size()) - offset;
+			vector<T> values = inputs;
+			Kernels::fastTanh(&values[offset], length);
+			for (unsigned i = 0; i < inputs.size(); ++i) {
+				T expected = i >= offset && i < offset + length ? Kernels::fastTanh(inputs[i]) : inputs[i];
+				if (isnan(expected) ? isnan(values[i]) : memcmp(&values[i], &expected, sizeof(T)) == 0) continue;
+				if (mismatches++ == 0) {
+					cout << "  " << what << " tanh(" << inputs[i] << ") at offset " << offset << ", length " << length << ": "
+						<< setprecision(17) << values[i] << " instead of " << expected << setprecision(6) << "\n";
+				}
+			}
+		}
+	}
+	vector<T> values = inputs;
+	Kernels::fastTanh(values.data(), unsigned(values.size()));
+	double worst = 0.0;
+	for (unsigned i = 0; i < inputs.size(); ++i) {
+		double exact = tanh(double(inputs[i]));
+		if (isnan(exact) ? isnan(values[i]) : fabs(double(values[i]) - exact) <= maxTanhError) {
+			if (!isnan(exact)) worst = max(worst, fabs(double(values[i]) - exact));
+			continue;
+		}
+		if (mismatches++ == 0) cout << "  " << what << " tanh(" << inputs[i] << ") = " << setprecision(17) << values[i] << ", " << exact << setprecision(6) << "\n";
+	}
+	cout << "  " << what << " fastTanh: largest error " << worst << "\n";
+	return mismatches;
+}
+
+/* the number of cases of results that are further from reference than tolerance times their scale. */
+static unsigned countMismatches(const char *what, const Results &results, const Results &reference, double tolerance) {
+	unsigned mismatches = 0;
+	for (unsigned r = 0; r < reference.values.size(); ++r) {
+		if (fabs(results.values[r] - reference.values[r]) <= tolerance * reference.scales[r]) continue;
+		if (mismatches++ == 0) {
+			cout << "  " << what << " case " << r << ": " << setprecision(17) << results.values[r] << " instead of "
+				<< reference.values[r] << setprecision(6) << "\n";
+		}
+	}
+	for (unsigned r = 0; r < reference.exact.size(); ++r) {
+		if (results.exact[r] == reference.exact[r]) continue;
+		if (mismatches++ == 0) cout << "  " << what << " case " << r << ": " << results.exact[r] << " instead of " << reference.exact[r] << "\n";
+	}
+	return mismatches;
+}
+
+int main(void) {
+	mt19937 random(12345);
+	uniform_real_distribution<double> uniform(-1.0, 1.0);
+	uniform_int_distribution<int> byte(-128, 127);
+	unsigned size = maxLength + maxOffset + 1;   // one past the last element any case touches
+	vector<double> a(size), b(size), c(size);
+	vector<float> aFloat(size), bFloat(size), cFloat(size);
+	vector<int8_t> aInt8(size), bInt8(size);
+	for (unsigned i = 0; i < size; ++i) {
+		a[i] = uniform(random);
+		b[i] = uniform(random);
+		c[i] = uniform(random);
+		aFloat[i] = float(a[i]);
+		bFloat[i] = float(b[i]);
+		cFloat[i] = float(c[i]);
+		aInt8[i] = int8_t(byte(random));
+		bInt8[i] = int8_t(byte(random));
+	}
+
+	string original = Kernels::name();
+	Results reference, referenceFloat, referenceInt8;
+	if (!Kernels::select("scalar")) {
+		cout << "the scalar path is missing\n";
+		return 1;
+	}
+	runCases(a, b, c, reference);
+	runCases(aFloat, bFloat, cFloat, referenceFloat);
+	runInt8Cases(aInt8, bInt8, referenceInt8);
+
+	unsigned failed = 0;
+	const vector<string> &paths = Kernels::paths();
+	for (unsigned p = 0; p < paths.size(); ++p) {
+		if (!Kernels::isSupported(paths[p])) {
+			cout << paths[p] << ": not supported here, skipped\n";
+			continue;
+		}
+		Kernels::select(paths[p]);
+		Results results, resultsFloat, resultsInt8;
+		runCases(a, b, c, results);
+		runCases(aFloat, bFloat, cFloat, resultsFloat);
+		runInt8Cases(aInt8, bInt8, resultsInt8);
+		unsigned mismatches = countMismatches("double", results, reference, 1e-14)
+			+ countMismatches("float", resultsFloat, referenceFloat, 1e-5)
+			+ countMismatches("int8", resultsInt8, referenceInt8, 0.0)
+			+ countTanhMismatches("double", tanhInputs<double>()) + countTanhMismatches("float", tanhInputs<float>());
+		cout << paths[p] << ": " << (mismatches == 0 ? "ok" : "FAILED") << " (" << reference.values.size() + referenceFloat.values.size()
+			+ referenceInt8.exact.size() << " values, " << mismatches << " off)\n";
+		if (mismatches > 0) ++failed;
+	}
+	Kernels::select(original);
+	return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,335 @@
+#include "Layer.h"
+#include "Kernels.h"
+
+/* layers initialize their input connections with random weight values. the random numbers are drawn one
+   previous-layer neuron at a time (the order the old per neuron Connection vectors drew them in), so
+   a seeded network starts from the same weights as before. the bias output is forced to 1.0. */
+template <typename T>
+BasicLayer<T>::BasicLayer(unsigned numNeurons, unsigned numInputs, const NetConfig &config)
+	: m_numNeurons(numNeurons), m_numInputs(numInputs), m_activation(Activation::TANH), m_optimizer(config.optimizer),
+	  m_weights(numNeurons * numInputs), m_deltaWeights(numNeurons * numInputs),
+	  m_outputVals(numNeurons + 1), m_gradients(numNeurons + 1),
+	  m_batchRows(0), m_weightGrads(numNeurons * numInputs), m_numPruned(0) {
+	for (unsigned i = 0; i < numInputs; ++i) {
+		for (unsigned n = 0; n < numNeurons; ++n) {
+			weight(n, i) = randomWeight();
+		}
+	}
+	m_outputVals.back() = 1.0;
+	setConfig(config);
+}
+
+template <typename T>
+void BasicLayer<T>::setConfig(const NetConfig &config) {
+	if (config.optimizer != m_optimizer) clearState();
+	m_optimizer = config.optimizer;
+	m_eta = T(config.eta);
+	m_alpha = T(config.alpha);
+	m_beta1 = config.beta1;
+	m_beta2 = config.beta2;
+	m_epsilon = config.epsilon;
+	m_squares.resize(config.adaptive() ? m_weights.size() : 0, 0.0);
+}
+
+template <typename T>
+void BasicLayer<T>::clearState(void) {
+	fill(m_deltaWeights.begin(), m_deltaWeights.end(), 0.0);
+	fill(m_squares.begin(), m_squares.end(), 0.0);
+}
+
+/* the previous layer's outputs and our gradients determine the new weights, one contiguous row per neuron. the
+   other optimizers gather the whole layer's changes first and update it in one pass. */
+template <typename T>
+void BasicLayer<T>::updateInputWeights(const BasicLayer &prevLayer, uint64_t step) {
+	const T *inputs = prevLayer.m_outputVals.data();
+	if (m_optimizer == NetConfig::MOMENTUM) {
+		for (unsigned n = 0; n < m_numNeurons; ++n) {
+			T *w = &m_weights[n * m_numInputs];
+			T *dw = &m_deltaWeights[n * m_numInputs];
+			Kernels::update(w, dw, inputs, m_eta, m_gradients[n], m_alpha, m_numInputs); // dw = eta * input * gradient + alpha * dw; w += dw
+		}
+		applyPruning(0, m_weights.size());
+		return;
+	}
+	for (unsigned n = 0; n < m_numNeurons; ++n) {
+		Kernels::axpy(&m_weightGrads[n * m_numInputs], inputs, m_eta * m_gradients[n], m_numInputs);
+	}
+	applyWeightGradients(0, m_weights.size(), step);
+}
+
+/* calculates the new gradients for a hidden layer. each neuron sums its contributions to the errors
+   at the nodes it feeds (sumDOW); walking the next layer's weight rows in order keeps that a contiguous
+   scaled add per row instead of a strided column read. */
+template <typename T>
+void BasicLayer<T>::calcHiddenGradients(const BasicLayer &nextLayer) {
+	fill(m_gradients.begin(), m_gradients.end(), 0.0);
+	for (unsigned n = 0; n < nextLayer.m_numNeurons; ++n) {
+		Kernels::axpy(m_gradients.data(), &nextLayer.m_weights[n * nextLayer.m_numInputs], nextLayer.m_gradients[n], m_numNeurons);
+	}
+	Activation::multiplyDerivative(m_activation, m_outputVals.data(), m_gradients.data(), m_numNeurons);
+}
+
+/* calculates the new gradients for the output layer. */
+template <typename T>
+void BasicLayer<T>::calcOutputGradients(const vector<double> &targetVals) {
+	for (unsigned n = 0; n < m_numNeurons; ++n) {
+		m_gradients[n] = T(targetVals[n]) - m_outputVals[n];   // delta
+	}
+	Activation::multiplyDerivative(m_activation, m_outputVals.data(), m_gradients.data(), m_numNeurons);
+}
+
+/* the sums of the whole layer first, then the transfer function over all of them at once. */
+template <typename T>
+void BasicLayer<T>::feedForward(const BasicLayer &prevLayer) {
+	const T *inputs = prevLayer.m_outputVals.data();
+	for (unsigned n = 0; n < m_numNeurons; ++n) {
+		                     // Sum the previous layer's outputs (which are our inputs)
+		                     //Includes the bias node from the previous layer.
+		m_outputVals[n] = Kernels::dot(inputs, &m_weights[n * m_numInputs], m_numInputs);
+	}
+	Activation::apply(m_activation, m_outputVals.data(), m_numNeurons);
+}
+
+/* the batch loops are blocked: a tile of weight rows is reused across a tile of samples while it is still in
+   cache, which turns the per sample matrix-vector products into a matrix-matrix product. the reduction over
+   each dot product or sum is never split, so every value is added up in the same order as the single sample
+   path and a batch of one reproduces it exactly. */
+static const unsigned ROW_BLOCK = 8;               // samples per tile
+static const unsigned TILE_DOUBLES = 8192;         // ~64KB of weights per tile
+
+static unsigned neuronBlock(unsigned rowLength) {
+	return max(1u, TILE_DOUBLES / max(1u, rowLength));
+}
+
+/* grows the batch buffers to hold at least numRows samples, smaller batches reuse them. */
+template <typename T>
+void BasicLayer<T>::resizeBatch(unsigned numRows) {
+	if (numRows <= m_batchRows) return;
+	m_batchRows = numRows;
+	m_batchOutputs.assign(numRows * (m_numNeurons + 1), 1.0); // the trailing bias column stays 1.0
+	m_batchGradients.assign(numRows * (m_numNeurons + 1), 0.0);
+	m_scaledInputs.assign(numRows * m_numInputs, 0.0);
+}
+
+template <typename T>
+void BasicLayer<T>::feedForwardBatch(const BasicLayer &prevLayer, unsigned numRows) {
+	forwardRows(prevLayer.m_batchOutputs.data(), prevLayer.m_numNeurons + 1, m_batchOutputs.data(), m_numNeurons + 1, numRows);
+}
+
+/* row r of inputRows holds the previous layer's outputs, bias included. only the weights are read, so any number of
+   threads can run this on one layer at the same time with their own buffers. */
+template <typename T>
+void BasicLayer<T>::forwardRows(const T *inputRows, unsigned inputStride, T *outputRows, unsigned outputStride, unsigned numRows) const {
+	forwardRows(m_weights.data(), m_numNeurons, m_numInputs, m_activation, inputRows, inputStride, outputRows, outputStride, numRows);
+}
+
+template <typename T>
+void BasicLayer<T>::forwardRows(const T *weights, unsigned numNeurons, unsigned numInputs, Activation::Kind activation,
+	const T *inputRows, unsigned inputStride, T *outputRows, unsigned outputStride, unsigned numRows) {
+	unsigned nBlock = neuronBlock(numInputs);
+	for (unsigned n0 = 0; n0 < numNeurons; n0 += nBlock) {
+		unsigned n1 = min(numNeurons, n0 + nBlock);
+		for (unsigned r0 = 0; r0 < numRows; r0 += ROW_BLOCK) {
+			unsigned r1 = min(numRows, r0 + ROW_BLOCK);
+			for (unsigned n = n0; n < n1; ++n) {
+				const T *w = weights + uint64_t(n) * numInputs;
+				for (unsigned r = r0; r < r1; ++r) {
+					outputRows[uint64_t(r) * outputStride + n] = Kernels::dot(inputRows + uint64_t(r) * inputStride, w, numInputs);
+				}
+			}
+		}
+	}
+	for (unsigned r = 0; r < numRows; ++r) Activation::apply(activation, outputRows + uint64_t(r) * outputStride, numNeurons);
+}
+
+template <typename T>
+void BasicLayer<T>::calcOutputGradientsBatch(const double *targetRows, unsigned targetStride, unsigned numRows) {
+	for (unsigned r = 0; r < numRows; ++r) {
+		const T *outputs = batchOutputRow(r);
+		const double *targets = targetRows + r * targetStride;
+		T *gradients = &m_batchGradients[r * (m_numNeurons + 1)];
+		for (unsigned n = 0; n < m_numNeurons; ++n) gradients[n] = T(targets[n]) - outputs[n];   // delta
+		Activation::multiplyDerivative(m_activation, outputs, gradients, m_numNeurons);
+	}
+}
+
+template <typename T>
+void BasicLayer<T>::calcHiddenGradientsBatch(const BasicLayer &nextLayer, unsigned numRows) {
+	fill(m_batchGradients.begin(), m_batchGradients.begin() + numRows * (m_numNeurons + 1), 0.0);
+	unsigned nBlock = neuronBlock(nextLayer.m_numInputs);
+	for (unsigned n0 = 0; n0 < nextLayer.m_numNeurons; n0 += nBlock) {
+		unsigned n1 = min(nextLayer.m_numNeurons, n0 + nBlock);
+		for (unsigned r = 0; r < numRows; ++r) {
+			T *gradients = &m_batchGradients[r * (m_numNeurons + 1)];
+			const T *nextGradients = &nextLayer.m_batchGradients[r * (nextLayer.m_numNeurons + 1)];
+			for (unsigned n = n0; n < n1; ++n) {
+				Kernels::axpy(gradients, &nextLayer.m_weights[n * nextLayer.m_numInputs], nextGradients[n], m_numNeurons);
+			}
+		}
+	}
+	for (unsigned r = 0; r < numRows; ++r) {
+		const T *outputs = batchOutputRow(r);
+		Activation::multiplyDerivative(m_activation, outputs, &m_batchGradients[r * (m_numNeurons + 1)], m_numNeurons);
+	}
+}
+
+/* adds eta / batchSize * input * gradient of every sample to the weight gradients, without touching the weights.
+   batchSize is the number of samples the update will be averaged over, which can be more than numRows when
+   several callers contribute to one update. */
+template <typename T>
+void BasicLayer<T>::accumulateWeightGradients(const BasicLayer &prevLayer, unsigned numRows, unsigned batchSize) {
+	T scale = m_eta / batchSize;
+	for (unsigned r = 0; r < numRows; ++r) {
+		const T *inputs = prevLayer.batchOutputRow(r);
+		T *scaled = &m_scaledInputs[r * m_numInputs];
+		for (unsigned i = 0; i < m_numInputs; ++i) scaled[i] = scale * inputs[i];
+	}
+	unsigned nBlock = neuronBlock(m_numInputs);
+	for (unsigned n0 = 0; n0 < m_numNeurons; n0 += nBlock) {
+		unsigned n1 = min(m_numNeurons, n0 + nBlock);
+		for (unsigned r0 = 0; r0 < numRows; r0 += ROW_BLOCK) {
+			unsigned r1 = min(numRows, r0 + ROW_BLOCK);
+			for (unsigned n = n0; n < n1; ++n) {
+				T *grads = &m_weightGrads[n * m_numInputs];
+				for (unsigned r = r0; r < r1; ++r) {
+					Kernels::axpy(grads, &m_scaledInputs[r * m_numInputs], m_batchGradients[r * (m_numNeurons + 1) + n], m_numInputs);
+				}
+			}
+		}
+	}
+}
+
+/* one fused update over a range of the weight matrix, then those gradients are cleared for the next batch. */
+template <typename T>
+void BasicLayer<T>::applyWeightGradients(unsigned begin, unsigned end, uint64_t step) {
+	applyChanges(m_weightGrads.data() + begin, begin, end, step);
+	fill(m_weightGrads.begin() + begin, m_weightGrads.begin() + end, 0.0);
+}
+
+/* the same update, but into another layer's weights and optimizer state (the shared weights of a lock-free
+   trainer), with that layer's settings. */
+template <typename T>
+void BasicLayer<T>::applyWeightGradientsTo(BasicLayer &shared, uint64_t step) {
+	shared.applyChanges(m_weightGrads.data(), 0, m_weights.size(), step);
+	fill(m_weightGrads.begin(), m_weightGrads.end(), 0.0);
+}
+
+/* changes holds eta times the gradient of weights [begin, end), the update the optimizer makes of it walks the
+   weights and their state once (see NetConfig for the rules). RMSPROP is ADAM without the gradient average
+   (beta1 = 0) and without the corrections for the first steps. */
+template <typename T>
+void BasicLayer<T>::applyChanges(const T *changes, unsigned begin, unsigned end, uint64_t step) {
+	T *w = m_weights.data() + begin, *dw = m_deltaWeights.data() + begin;
+	if (m_optimizer == NetConfig::MOMENTUM) {
+		Kernels::update(w, dw, changes, 1.0, 1.0, m_alpha, end - begin);
+	}
+	else if (m_optimizer == NetConfig::NESTEROV) {
+		Kernels::nesterov(w, dw, changes, m_alpha, end - begin);
+	}
+	else {
+		bool adam = m_optimizer == NetConfig::ADAM;
+		Kernels::Adaptive constants;
+		constants.gradScale = m_eta > 0 ? 1.0 / m_eta : 0.0;    // back to the gradient itself
+		constants.beta1 = adam ? m_beta1 : 0.0;
+		constants.beta2 = m_beta2;
+		constants.rate = adam ? m_eta / (1.0 - pow(m_beta1, double(step))) : double(m_eta);
+		constants.correction = adam ? 1.0 / (1.0 - pow(m_beta2, double(step))) : 1.0;
+		constants.epsilon = m_epsilon;
+		Kernels::adaptive(w, dw, m_squares.data() + begin, changes, constants, end - begin);
+	}
+	applyPruning(begin, end);
+}
+
+template <typename T>
+void BasicLayer<T>::applyPruning(unsigned begin, unsigned end) {
+	if (m_numPruned == 0) return;
+	for (unsigned i = begin; i < end; ++i) {
+		if (!m_pruned[i]) continue;
+		m_weights[i] = 0.0;
+		m_deltaWeights[i] = 0.0;
+		if (!m_squares.empty()) m_squares[i] = 0.0;
+	}
+}
+
+/* weights already pruned are zero, below any threshold, so pruning again only ever adds to them. */
+template <typename T>
+void BasicLayer<T>::prune(T threshold) {
+	if (m_pruned.empty()) m_pruned.assign(m_weights.size(), 0);
+	for (unsigned n = 0; n < m_numNeurons; ++n) {
+		for (unsigned i = 0; i + 1 < m_numInputs; ++i) {
+			unsigned w = n * m_numInputs + i;
+			if (m_pruned[w] || !(fabs(m_weights[w]) < threshold)) continue;
+			m_pruned[w] = 1;
+			++m_numPruned;
+		}
+	}
+	applyPruning(0, m_weights.size());
+}
+
+/* the pruned weights sort first (their magnitude is zero), so the sparsity never goes down. */
+template <typename T>
+void BasicLayer<T>::pruneToSparsity(double sparsity) {
+	unsigned target = unsigned(min(max(sparsity, 0.0), 1.0) * numPrunable() + 0.5);
+	if (target <= m_numPruned) return;
+	if (m_pruned.empty()) m_pruned.assign(m_weights.size(), 0);
+	vector<unsigned> order;
+	order.reserve(numPrunable());
+	for (unsigned n = 0; n < m_numNeurons; ++n) {
+		for (unsigned i = 0; i + 1 < m_numInputs; ++i) order.push_back(n * m_numInputs + i);
+	}
+	nth_element(order.begin(), order.begin() + (target - 1), order.end(), [this](unsigned a, unsigned b) {
+		T magnitudeA = m_pruned[a] ? T(0) : fabs(m_weights[a]), magnitudeB = m_pruned[b] ? T(0) : fabs(m_weights[b]);
+		return magnitudeA != magnitudeB ? magnitudeA < magnitudeB : m_pruned[a] > m_pruned[b];
+	});
+	for (unsigned k = 0; k < target; ++k) m_pruned[order[k]] = 1;
+	m_numPruned = target;
+	applyPruning(0, m_weights.size());
+}
+
+template <typename T>
+void BasicLayer<T>::setPruned(const uint8_t *pruned) {
+	m_numPruned = 0;
+	if (pruned == NULL) {
+		m_pruned.clear();
+		return;
+	}
+	m_pruned.assign(pruned, pruned + m_weights.size());
+	for (unsigned w = 0; w < m_pruned.size(); ++w) m_numPruned += m_pruned[w] != 0;
+	applyPruning(0, m_weights.size());
+}
+
+template <typename T>
+void BasicLayer<T>::addWeightGradients(BasicLayer &other, unsigned begin, unsigned end) {
+	Kernels::axpy(m_weightGrads.data() + begin, other.m_weightGrads.data() + begin, 1.0, end - begin);
+	fill(other.m_weightGrads.begin() + begin, other.m_weightGrads.begin() + end, 0.0);
+}
+
+template <typename T>
+void BasicLayer<T>::copyBatchRowToOutputs(unsigned r) {
+	copy(batchOutputRow(r), batchOutputRow(r) + m_numNeurons, m_outputVals.begin());
+}
+
+/* the gradient of one sample is the outer product of our gradients and the inputs, whose norm is the product of
+   theirs. */
+template <typename T>
+double BasicLayer<T>::sampleGradientNorm(const BasicLayer &prevLayer) const {
+	double gradients = 0.0, inputs = 0.0;
+	for (unsigned n = 0; n < m_numNeurons; ++n) gradients += double(m_gradients[n]) * m_gradients[n];
+	for (unsigned i = 0; i < m_numInputs; ++i) inputs += double(prevLayer.m_outputVals[i]) * prevLayer.m_outputVals[i];
+	return sqrt(gradients * inputs);
+}
+
+/* the accumulated gradients carry eta / batchSize, dividing eta back out leaves the mean over the batch. */
+template <typename T>
+double BasicLayer<T>::weightGradientNorm(const vector<const BasicLayer *> &parts) {
+	double squares = 0.0;
+	for (unsigned i = 0; i < parts.front()->m_weightGrads.size(); ++i) {
+		double sum = 0.0;
+		for (unsigned p = 0; p < parts.size(); ++p) sum += parts[p]->m_weightGrads[i];
+		squares += sum * sum;
+	}
+	return sqrt(squares) / parts.front()->m_eta;
+}
+
+template class BasicLayer<double>;
+template class BasicLayer<float>;
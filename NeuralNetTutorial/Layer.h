@@ -0,0 +1,105 @@
+#pragma once
+#ifndef Layer_H
+#define Layer_H
+#include "Globalfuncs.h"
+#include "NetConfig.h"
+#include "Activation.h"
+using namespace std;
+
+/* a dense layer of neurons. every array the layer owns is contiguous, so the inner loops walk memory in order
+   instead of hopping through one heap allocated vector<Connection> per neuron.
+   the weights are stored in the layer they feed INTO, row-major by neuron: row n holds the weights from every
+   neuron of the previous layer (including its bias neuron) into our neuron n.
+   T is the scalar everything is stored and computed in (double or float, see the instantiations in Layer.cpp).
+   samples, targets and checkpoints stay double on the outside and are converted on the way in and out. */
+template <typename T>
+class BasicLayer {
+public:
+	BasicLayer(unsigned numNeurons, unsigned numInputs, const NetConfig &config); // numInputs is the previous layer size plus its bias, 0 for the input layer
+	void setConfig(const NetConfig &config);    // the rates and the optimizer, a different optimizer starts with no state
+	Activation::Kind getActivation(void) const { return m_activation; }
+	void setActivation(Activation::Kind activation) { m_activation = activation; }   // tanh unless it is set
+	unsigned size(void) const { return m_numNeurons; }       // number of neurons, NOT counting the bias neuron
+	unsigned numInputs(void) const { return m_numInputs; }
+	void setOutputVal(unsigned n, T val) { m_outputVals[n] = val; }
+	T getOutputVal(unsigned n) const { return m_outputVals[n]; }
+	const T *getOutputVals(void) const { return m_outputVals.data(); }
+	T &weight(unsigned n, unsigned i) { return m_weights[n * m_numInputs + i]; }
+	T &deltaWeight(unsigned n, unsigned i) { return m_deltaWeights[n * m_numInputs + i]; }
+	T getWeight(unsigned n, unsigned i) const { return m_weights[n * m_numInputs + i]; }
+	T getDeltaWeight(unsigned n, unsigned i) const { return m_deltaWeights[n * m_numInputs + i]; }
+	const T *getWeights(void) const { return m_weights.data(); }           // numWeights() values, same layout as weight()
+	const T *getDeltaWeights(void) const { return m_deltaWeights.data(); }
+	const T *getSquares(void) const { return m_squares.data(); }           // the adaptive optimizers' squared gradient averages, else NULL
+	void setSquares(const double *squares) { copy(squares, squares + m_squares.size(), m_squares.begin()); }
+	void clearState(void);                      // forgets the optimizer's state (momentum and averages)
+	void setWeights(const double *weights, const double *deltaWeights) {   // numWeights() of each, converted to T
+		copy(weights, weights + m_weights.size(), m_weights.begin());
+		copy(deltaWeights, deltaWeights + m_deltaWeights.size(), m_deltaWeights.begin());
+	}
+	void feedForward(const BasicLayer &prevLayer);
+	void calcOutputGradients(const vector<double> &targetVals);
+	void calcHiddenGradients(const BasicLayer &nextLayer);
+	void updateInputWeights(const BasicLayer &prevLayer, uint64_t step); // step counts the net's updates from 1 (Adam's t)
+
+	/* mini-batch versions of the above. row r of the batch buffers holds sample r, the bias output included.
+	   the weight gradients of every row are summed before a single momentum update is applied. */
+	void resizeBatch(unsigned numRows);
+	T *batchOutputRow(unsigned r) { return &m_batchOutputs[r * (m_numNeurons + 1)]; }
+	const T *batchOutputRow(unsigned r) const { return &m_batchOutputs[r * (m_numNeurons + 1)]; }
+	void feedForwardBatch(const BasicLayer &prevLayer, unsigned numRows);
+	void forwardRows(const T *inputRows, unsigned inputStride, T *outputRows, unsigned outputStride, unsigned numRows) const;
+	// the same pass over any weights laid out like ours, for copies that keep nothing but the weights (see Model.h)
+	static void forwardRows(const T *weights, unsigned numNeurons, unsigned numInputs, Activation::Kind activation,
+		const T *inputRows, unsigned inputStride, T *outputRows, unsigned outputStride, unsigned numRows);
+	void calcOutputGradientsBatch(const double *targetRows, unsigned targetStride, unsigned numRows);
+	void calcHiddenGradientsBatch(const BasicLayer &nextLayer, unsigned numRows);
+	void accumulateWeightGradients(const BasicLayer &prevLayer, unsigned numRows, unsigned batchSize);
+	void applyWeightGradients(unsigned begin, unsigned end, uint64_t step);   // updates weights [begin, end)
+	void applyWeightGradientsTo(BasicLayer &shared, uint64_t step);          // updates another layer's weights with our gradients
+	void addWeightGradients(BasicLayer &other, unsigned begin, unsigned end); // moves the other layer's gradients into ours
+	void copyWeights(const BasicLayer &other) { m_weights = other.m_weights; m_pruned = other.m_pruned; m_numPruned = other.m_numPruned; }
+	unsigned numWeights(void) const { return m_weights.size(); }
+	void copyBatchRowToOutputs(unsigned r);     // makes sample r the layer's current output (what getResults reads)
+	/* L2 norms of the error gradient of the weights, for telemetry: of the last backProp, and of the accumulated
+	   batch gradients summed over parts (the replicas a batch was split between), before they are applied. */
+	double sampleGradientNorm(const BasicLayer &prevLayer) const;
+	static double weightGradientNorm(const vector<const BasicLayer *> &parts);
+
+	/* magnitude pruning. a pruned weight is set to zero along with its optimizer state and kept there by every
+	   update after it, so training carries on around it. the bias column is never pruned. */
+	void prune(T threshold);                    // every weight smaller in magnitude than threshold
+	void pruneToSparsity(double sparsity);      // the smallest weights until that fraction of the prunable ones is pruned
+	void setPruned(const uint8_t *pruned);      // numWeights() flags, 1 for pruned, or NULL to prune nothing
+	const uint8_t *getPruned(void) const { return m_pruned.empty() ? NULL : m_pruned.data(); }   // NULL if nothing is
+	bool isPruned(unsigned n, unsigned i) const { return !m_pruned.empty() && m_pruned[n * m_numInputs + i]; }
+	unsigned numPruned(void) const { return m_numPruned; }
+	unsigned numPrunable(void) const { return m_numInputs == 0 ? 0 : m_numNeurons * (m_numInputs - 1); }
+private:
+	static double randomWeight() { return rand() / double(RAND_MAX); }
+	void applyChanges(const T *changes, unsigned begin, unsigned end, uint64_t step);
+	void applyPruning(unsigned begin, unsigned end);   // zeroes the pruned weights of [begin, end) and their state
+	unsigned m_numNeurons;
+	unsigned m_numInputs;
+	Activation::Kind m_activation;  // the transfer function of our neurons
+	T m_eta;                    // [0.0..1.0] training rate, the net's (see NetConfig)
+	T m_alpha;                  // [0.0..n] multiplier of the last weight change (momentum)
+	NetConfig::Optimizer m_optimizer;
+	double m_beta1, m_beta2, m_epsilon;
+	vector<T> m_weights;        // m_numNeurons rows of m_numInputs weights
+	vector<T> m_deltaWeights;   // the optimizer's per weight state, same layout as m_weights: the last change of each
+	                            // weight (MOMENTUM), the velocity (NESTEROV), the last gradient (RMSPROP) or the
+	                            // gradient average (ADAM)
+	vector<T> m_squares;        // RMSPROP and ADAM: the squared gradient average, same layout, empty for the others
+	vector<T> m_outputVals;     // m_numNeurons outputs followed by the bias neuron's output (always 1.0)
+	vector<T> m_gradients;      // one gradient per output value
+	unsigned m_batchRows;       // rows the batch buffers can hold
+	vector<T> m_batchOutputs;   // m_batchRows rows of m_numNeurons + 1 outputs
+	vector<T> m_batchGradients; // same layout as m_batchOutputs
+	vector<T> m_scaledInputs;   // eta / batch size times the previous layer's outputs, one row per sample
+	vector<T> m_weightGrads;    // summed weight changes of the batch (eta times the gradient), same layout as m_weights
+	vector<uint8_t> m_pruned;   // 1 for every pruned weight, same layout as m_weights, empty until something is pruned
+	unsigned m_numPruned;
+};
+typedef BasicLayer<double> Layer;
+#endif // !Layer_H
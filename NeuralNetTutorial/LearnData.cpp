@@ -1,12 +1,44 @@
 #include "LearnData.h"
 
-/* makes a LearnData object with passed file name. */
-LearnData::LearnData(const string filename) {
-	m_trainingDataFile.open(filename.c_str());
+/* makes a LearnData object with passed file name. files starting with the binary magic are mapped into memory,
+   anything else is read as the text format. */
+LearnData::LearnData(const string filename)
+	: m_numInputs(0), m_numOutputs(0), m_readerRows(NULL), m_readerRowsLeft(0), m_readerEnded(false),
+	  m_pendingRow(NULL), m_rows(NULL), m_numSamples(0), m_nextSample(0), m_cached(false), m_cacheRows(NULL), m_cacheSamples(0) {
+	if (!openBinary(filename)) m_trainingDataFile.open(filename.c_str());
+}
+
+/* maps the file and checks its header, false (and nothing mapped) if it isn't a valid binary dataset. */
+bool LearnData::openBinary(const string &fileName) {
+	if (!m_mapped.open(fileName)) return false;
+	BinaryDataHeader header;
+	if (m_mapped.size() < sizeof(header)) { m_mapped.close(); return false; }
+	memcpy(&header, m_mapped.data(), sizeof(header));
+	if (memcmp(header.magic, BINARY_DATA_MAGIC, 4) != 0) { m_mapped.close(); return false; }
+	uint64_t topologyBytes = (uint64_t(header.numLayers) * sizeof(uint32_t) + 7) / 8 * 8;
+	if (header.version != BINARY_DATA_VERSION || header.numLayers < 2 || m_mapped.size() < sizeof(header) + topologyBytes) {
+		cerr << fileName << " is a binary dataset this program can't read.\n";
+		abort();
+	}
+	const uint32_t *topology = reinterpret_cast<const uint32_t *>(m_mapped.data() + sizeof(header));
+	m_topology.assign(topology, topology + header.numLayers);
+	m_numInputs = m_topology.front();
+	m_numOutputs = m_topology.back();
+	m_numSamples = header.numSamples;
+	if (m_mapped.size() < sizeof(header) + topologyBytes + m_numSamples * (m_numInputs + m_numOutputs) * sizeof(double)) {
+		cerr << fileName << " is shorter than its header says.\n";
+		abort();
+	}
+	m_rows = reinterpret_cast<const double *>(m_mapped.data() + sizeof(header) + topologyBytes);
+	return true;
 }
 
 /* reads the top line of the file and saves topology values in vector. */
 void LearnData::getTopology(vector<unsigned> &topology) {
+	if (isBinary()) {
+		topology.insert(topology.end(), m_topology.begin(), m_topology.end());
+		return;
+	}
 	string line, label;
 	getline(m_trainingDataFile, line);
 	stringstream ss(line);
@@ -17,37 +49,128 @@ void LearnData::getTopology(vector<unsigned> &topology) {
 		ss >> n;
 		topology.push_back(n);
 	}
+	m_numInputs = topology.front();
+	m_numOutputs = topology.back();
 }
 
 /* each of these learndata member functions are variations of the same method.
-   clears and fills the values in the vector passed. */
+   clears and fills the values in the vector passed. they take one sample at a time from getNextBatch. */
 unsigned LearnData::getNextInputs(vector<double> &inputVals) {
 	inputVals.clear();
-	string line, label;
-	getline(m_trainingDataFile, line);
-	stringstream ss(line);
-	ss >> label;
-	if (label.compare("in:") == 0) {
-		double oneValue;
-		while (ss >> oneValue) {
-			inputVals.push_back(oneValue);
-		}
-	}
+	const double *row;
+	m_pendingRow = getNextBatch(row, 1) == 1 ? row : NULL;
+	if (m_pendingRow != NULL) inputVals.assign(row, row + m_numInputs);
 	return inputVals.size();
 }
 
-/* just like above function but for target output values. */
+/* just like above function but for target output values, of the sample getNextInputs read. */
 unsigned LearnData::getTargetOutputs(vector<double> &targetOutputVals) {
 	targetOutputVals.clear();
-	string line, label;
-	getline(m_trainingDataFile, line);
-	stringstream ss(line);
-	ss >> label;
-	if (label.compare("out:") == 0) {
-		double oneValue;
-		while (ss >> oneValue) {
-			targetOutputVals.push_back(oneValue);
+	if (m_pendingRow != NULL) targetOutputVals.assign(m_pendingRow + m_numInputs, m_pendingRow + m_numInputs + m_numOutputs);
+	m_pendingRow = NULL;
+	return targetOutputVals.size();
+}
+
+/* reads up to maxSamples in:/out: line pairs and points samples at them, one row per sample holding the input
+   values followed by the target values (the layout Net::trainBatch takes). the rows stay valid until the next
+   call. stops early at the end of the file or at the first in: line that doesn't match the topology.
+   text files are parsed ahead on the reader's thread; the rows come straight out of its batches unless the
+   request runs past the end of one, then they are gathered into m_batch. */
+unsigned LearnData::getNextBatch(const double *&samples, unsigned maxSamples) {
+	if (isBinary()) {                                    // zero copy: the rows are handed out straight from the mapping
+		unsigned numSamples = unsigned(min<uint64_t>(maxSamples, m_numSamples - m_nextSample));
+		samples = getSample(m_nextSample);
+		m_nextSample += numSamples;
+		return numSamples;
+	}
+	unsigned stride = m_numInputs + m_numOutputs;
+	if (!m_reader) m_reader.reset(new TextSampleReader(m_trainingDataFile, m_numInputs, m_numOutputs));
+	if (m_readerRowsLeft >= maxSamples) {
+		samples = m_readerRows;
+		m_readerRows += uint64_t(maxSamples) * stride;
+		m_readerRowsLeft -= maxSamples;
+		return maxSamples;
+	}
+	m_batch.clear();
+	unsigned numSamples = 0;
+	while (numSamples < maxSamples && !m_readerEnded) {
+		if (m_readerRowsLeft == 0) {
+			m_readerRowsLeft = m_reader->next(m_readerRows);
+			m_readerEnded = m_readerRowsLeft == 0;
+			continue;
 		}
+		unsigned count = min(m_readerRowsLeft, maxSamples - numSamples);
+		m_batch.insert(m_batch.end(), m_readerRows, m_readerRows + uint64_t(count) * stride);
+		m_readerRows += uint64_t(count) * stride;
+		m_readerRowsLeft -= count;
+		numSamples += count;
 	}
-	return targetOutputVals.size();
+	samples = m_batch.data();
+	return numSamples;
+}
+
+/* the text is still parsed on the reader's thread, its batches are appended to the cache as they come. */
+const double *LearnData::getAllSamples(uint64_t &numSamples) {
+	if (!m_cached) {
+		if (isBinary()) {
+			m_cacheRows = getSample(m_nextSample);
+			m_cacheSamples = m_numSamples - m_nextSample;
+			m_nextSample = m_numSamples;
+		}
+		else {
+			unsigned stride = m_numInputs + m_numOutputs;
+			if (!m_reader) m_reader.reset(new TextSampleReader(m_trainingDataFile, m_numInputs, m_numOutputs));
+			while (true) {
+				if (m_readerRowsLeft == 0 && !m_readerEnded) {
+					m_readerRowsLeft = m_reader->next(m_readerRows);
+					m_readerEnded = m_readerRowsLeft == 0;
+				}
+				if (m_readerRowsLeft == 0) break;
+				m_cache.insert(m_cache.end(), m_readerRows, m_readerRows + uint64_t(m_readerRowsLeft) * stride);
+				m_cacheSamples += m_readerRowsLeft;
+				m_readerRowsLeft = 0;
+			}
+			m_cacheRows = m_cache.data();
+		}
+		m_cached = true;
+	}
+	numSamples = m_cacheSamples;
+	return m_cacheRows;
+}
+
+/* how long training has waited on the text reader, false for binary files or before the first batch. */
+bool LearnData::getReaderStats(TextSampleReader::Stats &stats) const {
+	if (!m_reader) return false;
+	stats = m_reader->getStats();
+	return true;
+}
+
+/* converts a text data file into the binary format, streaming it in chunks so the text file can be any size.
+   the sample count isn't known until the end, so the header is written again once everything else is. */
+bool LearnData::convertToBinary(const string &textFileName, const string &binaryFileName) {
+	LearnData text(textFileName);
+	if (!text.m_trainingDataFile.is_open()) return false;
+	vector<unsigned> topology;
+	text.getTopology(topology);
+	ofstream out(binaryFileName.c_str(), ios::binary | ios::trunc);
+	if (!out) return false;
+	BinaryDataHeader header;
+	memcpy(header.magic, BINARY_DATA_MAGIC, 4);
+	header.version = BINARY_DATA_VERSION;
+	header.numLayers = topology.size();
+	header.reserved = 0;
+	header.numSamples = 0;
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	vector<uint32_t> paddedTopology((topology.size() + 1) / 2 * 2, 0); // pads the rows to an 8 byte boundary
+	copy(topology.begin(), topology.end(), paddedTopology.begin());
+	out.write(reinterpret_cast<const char *>(paddedTopology.data()), paddedTopology.size() * sizeof(uint32_t));
+	const double *samples;
+	unsigned numSamples;
+	while ((numSamples = text.getNextBatch(samples, 4096)) > 0) {
+		out.write(reinterpret_cast<const char *>(samples), uint64_t(numSamples) * (topology.front() + topology.back()) * sizeof(double));
+		header.numSamples += numSamples;
+	}
+	out.seekp(0, ios::beg);
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	return bool(out);
 }
\ No newline at end of file
@@ -2,15 +2,62 @@
 #ifndef LearnData_H
 #define LearnData_H
 #include "Globalfuncs.h"
+#include "MappedFile.h"
+#include "TextSampleReader.h"
 using namespace std; //lets us use everything in the std namespace without the scoping operator (ie std::vector<T>)
-class LearnData {    //holds the data file that the network will train on
+
+/* the binary dataset format (little endian, written by convertToBinary):
+     BinaryDataHeader, then numLayers uint32 topology values padded to a multiple of 8 bytes,
+     then numSamples rows of topology.front() input doubles followed by topology.back() target doubles.
+   the rows are exactly the layout Net::trainBatch takes, so a mapped file is trained on without any copying. */
+struct BinaryDataHeader {
+	char magic[4];         // "NNDS"
+	uint32_t version;      // BINARY_DATA_VERSION
+	uint32_t numLayers;
+	uint32_t reserved;
+	uint64_t numSamples;
+};
+static const char BINARY_DATA_MAGIC[4] = { 'N', 'N', 'D', 'S' };
+static const uint32_t BINARY_DATA_VERSION = 1;
+
+class LearnData {    //holds the data file that the network will train on, either the text format or a mapped binary file
 public:
 	LearnData(const string fileName);
-	bool isEof() { return m_trainingDataFile.eof(); }
+	bool isEof() { return m_mapped.isOpen() ? m_nextSample >= m_numSamples : m_readerEnded || (!m_reader && m_trainingDataFile.eof()); }
 	void getTopology(vector<unsigned> &topology);
 	unsigned getNextInputs(vector<double> &inputVals); // Returns the number of input values read from the file:
 	unsigned getTargetOutputs(vector<double> &targetOutputVals);
+	unsigned getNextBatch(const double *&samples, unsigned maxSamples); // Returns the number of samples read, see below
+	bool getReaderStats(TextSampleReader::Stats &stats) const;
+
+	// only a binary file knows its size up front and can be read out of order or more than once
+	bool isBinary(void) const { return m_mapped.isOpen(); }
+	uint64_t numSamples(void) const { return m_numSamples; }
+	const double *getSample(uint64_t i) const { return m_rows + i * (m_numInputs + m_numOutputs); }
+	void rewind(void) { m_nextSample = 0; }
+	// every sample not read yet, in memory: a binary file's rows are used where they are mapped, a text file is
+	// parsed once and kept. later calls return the same rows (and getNextBatch has nothing left to give)
+	const double *getAllSamples(uint64_t &numSamples);
+	static bool convertToBinary(const string &textFileName, const string &binaryFileName);
 private:
+	bool openBinary(const string &fileName);
 	ifstream m_trainingDataFile;
+	unsigned m_numInputs;    // from the topology line
+	unsigned m_numOutputs;
+	vector<double> m_batch;  // rows gathered from more than one of the reader's batches
+	unique_ptr<TextSampleReader> m_reader; // parses the text file on its own thread, started by the first getNextBatch
+	const double *m_readerRows;            // the part of the reader's current batch not handed out yet
+	unsigned m_readerRowsLeft;
+	bool m_readerEnded;
+	const double *m_pendingRow;            // the sample getNextInputs returned, for getTargetOutputs
+	MappedFile m_mapped;     // the whole binary file
+	vector<unsigned> m_topology;
+	const double *m_rows;    // first sample row inside the mapping
+	uint64_t m_numSamples;
+	uint64_t m_nextSample;
+	bool m_cached;           // getAllSamples has run
+	vector<double> m_cache;  // a text file's samples, once getAllSamples has read them
+	const double *m_cacheRows;
+	uint64_t m_cacheSamples;
 };
-#endif
\ No newline at end of file
+#endif
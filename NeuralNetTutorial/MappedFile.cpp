@@ -0,0 +1,60 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : m_data(NULL), m_size(0), m_fileHandle(NULL), m_mappingHandle(NULL) {}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const string &fileName) {
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) { CloseHandle(file); return false; }
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) { CloseHandle(file); return false; }
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL) { CloseHandle(mapping); CloseHandle(file); return false; }
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+	m_size = uint64_t(size.QuadPart);
+	m_data = static_cast<const char *>(view);
+#else
+	int fd = ::open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) { ::close(fd); return false; }
+	void *view = mmap(NULL, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);                                     // the mapping keeps its own reference to the file
+	if (view == MAP_FAILED) return false;
+	m_size = uint64_t(info.st_size);
+	m_data = static_cast<const char *>(view);
+#endif
+	return true;
+}
+
+void MappedFile::close(void) {
+	if (m_data == NULL) return;
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle(static_cast<HANDLE>(m_mappingHandle));
+	CloseHandle(static_cast<HANDLE>(m_fileHandle));
+#else
+	munmap(const_cast<char *>(m_data), size_t(m_size));
+#endif
+	m_data = NULL;
+	m_size = 0;
+	m_fileHandle = m_mappingHandle = NULL;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#ifndef MappedFile_H
+#define MappedFile_H
+#include "Globalfuncs.h"
+using namespace std;
+
+/* a read-only memory mapping of a whole file. the operating system pages the file in on demand and the bytes
+   stay valid for as long as the object lives, so callers can hand out pointers into it instead of copying. */
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+	bool open(const string &fileName);  // false if the file can't be opened or mapped
+	void close(void);
+	bool isOpen(void) const { return m_data != NULL; }
+	const char *data(void) const { return m_data; }
+	uint64_t size(void) const { return m_size; }
+private:
+	MappedFile(const MappedFile &);            // a mapping has exactly one owner
+	MappedFile &operator=(const MappedFile &);
+	const char *m_data;
+	uint64_t m_size;
+	void *m_fileHandle;                        // windows needs both handles to unmap, posix only the address
+	void *m_mappingHandle;
+};
+#endif // !MappedFile_H
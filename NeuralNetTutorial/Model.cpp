@@ -0,0 +1,67 @@
+#include "Model.h"
+
+template <typename T>
+BasicModel<T>::BasicModel(const BasicNet<T> &net, uint64_t version)
+	: m_numInputs(net.getNumInputs()), m_widest(0), m_version(version), m_weightVersion(net.getWeightVersion()) {
+	for (unsigned layerNum = 0; layerNum < net.getNumLayers(); ++layerNum) {
+		const BasicLayer<T> &layer = net.getLayer(layerNum);
+		m_widest = max(m_widest, layer.size() + 1);
+		if (layerNum == 0) continue;
+		ModelLayer modelLayer;
+		modelLayer.numNeurons = layer.size();
+		modelLayer.numInputs = layer.numInputs();
+		modelLayer.activation = layer.getActivation();
+		modelLayer.weights.assign(layer.getWeights(), layer.getWeights() + layer.numWeights());
+		m_layers.push_back(modelLayer);
+	}
+}
+
+template <typename T>
+vector<unsigned> BasicModel<T>::getTopology(void) const {
+	vector<unsigned> topology(1, m_numInputs);
+	for (unsigned l = 0; l < m_layers.size(); ++l) topology.push_back(m_layers[l].numNeurons);
+	return topology;
+}
+
+/* the same passes as Net::inferBatch, so a model answers exactly like the net it was copied from. */
+template <typename T>
+void BasicModel<T>::inferBatch(const double *inputs, unsigned inputStride, unsigned numRows, double *outputs, Workspace &workspace) const {
+	uint64_t half = uint64_t(numRows) * m_widest;
+	if (workspace.rows.size() < 2 * half) workspace.rows.resize(2 * half);
+	T *rows = workspace.rows.data(), *nextRows = workspace.rows.data() + half;
+	for (unsigned r = 0; r < numRows; ++r) {     // the input layer's outputs are the inputs plus the bias neuron
+		copy(inputs + uint64_t(r) * inputStride, inputs + uint64_t(r) * inputStride + m_numInputs, rows + uint64_t(r) * (m_numInputs + 1));
+		rows[uint64_t(r) * (m_numInputs + 1) + m_numInputs] = 1.0;
+	}
+	for (unsigned l = 0; l < m_layers.size(); ++l) {
+		const ModelLayer &layer = m_layers[l];
+		unsigned stride = layer.numNeurons + 1;
+		BasicLayer<T>::forwardRows(layer.weights.data(), layer.numNeurons, layer.numInputs, layer.activation, rows, layer.numInputs, nextRows, stride, numRows);
+		for (unsigned r = 0; r < numRows; ++r) nextRows[uint64_t(r) * stride + layer.numNeurons] = 1.0;
+		swap(rows, nextRows);
+	}
+	unsigned numOutputs = getNumOutputs();
+	for (unsigned r = 0; r < numRows; ++r) {
+		copy(rows + uint64_t(r) * (numOutputs + 1), rows + uint64_t(r) * (numOutputs + 1) + numOutputs, outputs + uint64_t(r) * numOutputs);
+	}
+}
+
+template <typename T>
+const double *BasicModel<T>::infer(const double *inputVals, Workspace &workspace) const {
+	workspace.outputs.resize(getNumOutputs());
+	inferBatch(inputVals, m_numInputs, 1, workspace.outputs.data(), workspace);
+	return workspace.outputs.data();
+}
+
+/* the copy is made before the store, readers only ever see finished models. */
+template <typename T>
+void BasicModelPublisher<T>::publish(const BasicNet<T> &net) {
+	Snapshot model = make_shared<const BasicModel<T> >(net, m_published + 1);
+	atomic_store(&m_current, model);
+	++m_published;
+}
+
+template class BasicModel<double>;
+template class BasicModel<float>;
+template class BasicModelPublisher<double>;
+template class BasicModelPublisher<float>;
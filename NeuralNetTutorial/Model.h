@@ -0,0 +1,56 @@
+#pragma once
+#ifndef Model_H
+#define Model_H
+#include "Net.h"
+
+/* the part of a trained net inference needs, frozen: the topology, the activations and a copy of the weights, nothing else. a model
+   is never changed after it is built, every activation of a forward pass lives in a Workspace the caller owns, so
+   any number of threads can run one model at the same time without locks (each with its own workspace). */
+template <typename T>
+class BasicModel {
+public:
+	struct Workspace {             // one per thread, grows to the largest batch it has seen and is then reused
+		vector<T> rows;            // two halves: the layer being read and the layer being written
+		vector<double> outputs;    // what infer returns
+	};
+	typedef Workspace Scratch;     // the name BasicInference and Net::inferBatch use
+	BasicModel(const BasicNet<T> &net, uint64_t version);
+	void inferBatch(const double *inputs, unsigned inputStride, unsigned numRows, double *outputs, Workspace &workspace) const;
+	const double *infer(const double *inputVals, Workspace &workspace) const;   // one sample, getNumOutputs() values
+	unsigned getNumInputs(void) const { return m_numInputs; }
+	unsigned getNumOutputs(void) const { return m_layers.back().numNeurons; }
+	vector<unsigned> getTopology(void) const;
+	uint64_t getVersion(void) const { return m_version; }   // which publish made it, see BasicModelPublisher
+	uint64_t getWeightVersion(void) const { return m_weightVersion; }   // the net's when it was copied, for InferenceCache
+private:
+	struct ModelLayer {
+		unsigned numNeurons, numInputs; // numInputs counts the previous layer's bias neuron
+		Activation::Kind activation;
+		vector<T> weights;              // laid out like BasicLayer's
+	};
+	unsigned m_numInputs;
+	unsigned m_widest;                  // neurons of the widest layer, bias included
+	vector<ModelLayer> m_layers;        // every layer after the input layer
+	uint64_t m_version;
+	uint64_t m_weightVersion;
+};
+
+/* hands the latest model to readers while a trainer keeps making new ones (read-copy-update). publish copies the
+   net's weights into a new model and swaps the shared pointer to it in one atomic store. a reader's acquire is one
+   atomic load: it keeps the model it got for as long as it holds the pointer, so inference never waits for
+   training and never sees half updated weights. an old model is freed when its last reader lets go of it. */
+template <typename T>
+class BasicModelPublisher {
+public:
+	typedef shared_ptr<const BasicModel<T> > Snapshot;
+	BasicModelPublisher() : m_published(0) {}
+	void publish(const BasicNet<T> &net);   // from one thread at a time, the trainer's
+	Snapshot acquire(void) const { return atomic_load(&m_current); }   // NULL until the first publish
+	uint64_t getPublished(void) const { return m_published; }
+private:
+	Snapshot m_current;                 // only read and written through atomic_load and atomic_store
+	atomic<uint64_t> m_published;       // the version of the latest model
+};
+typedef BasicModel<double> Model;
+typedef BasicModelPublisher<double> ModelPublisher;
+#endif // !Model_H
@@ -1,138 +1,515 @@
 #include "Net.h"
-double Net::m_recentAverageSmoothingFactor = 100.0; // Number of training samples to average over
 
-/* fills the network with layers of neurons, with a bias neuron in each layer. */
-Net::Net(const vector<unsigned> &topology) {
+/* fills the network with layers of neurons, each layer carries its own bias neuron. */
+template <typename T>
+BasicNet<T>::BasicNet(const vector<unsigned> &topology, const NetConfig &config)
+	: m_error(0.0), m_recentAverageError(0.0), m_errorSum(0.0), m_errorCount(0), m_config(config), m_updates(0),
+	  m_weightVersion(InferenceCache::newVersion()), m_counters(NULL) {
+	m_layers.reserve(topology.size());
 	for (unsigned layerNum = 0; layerNum < topology.size(); ++layerNum) {
-		m_layers.push_back(Layer());
-		unsigned numOutputs = layerNum == topology.size() - 1 ? 0 : topology[layerNum + 1];
-		for (unsigned neuronNum = 0; neuronNum <= topology[layerNum]; ++neuronNum) { // We have a new layer, now fill it with neurons, and
-			m_layers.back().push_back(Neuron(numOutputs, neuronNum)); 	             // adds a bias neuron in each layer.
-		}
-		m_layers.back().back().setOutputVal(1.0); // Force the bias node's output to 1.0 (it was the last neuron pushed in this layer):
+		unsigned numInputs = layerNum == 0 ? 0 : topology[layerNum - 1] + 1; // the previous layer's neurons plus its bias
+		m_layers.push_back(BasicLayer<T>(topology[layerNum], numInputs, config));
+	}
+}
+
+/* takes effect from the next weight update. the weights are kept, and so is the optimizer's state unless the
+   optimizer changes. */
+template <typename T>
+void BasicNet<T>::setConfig(const NetConfig &config) {
+	if (config.optimizer != m_config.optimizer) m_updates = 0;
+	m_config = config;
+	for (unsigned layerNum = 0; layerNum < m_layers.size(); ++layerNum) m_layers[layerNum].setConfig(config);
+}
+
+template <typename T>
+vector<Activation::Kind> BasicNet<T>::getActivations(void) const {
+	vector<Activation::Kind> activations;
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) activations.push_back(m_layers[layerNum].getActivation());
+	return activations;
+}
+
+template <typename T>
+void BasicNet<T>::setActivations(const vector<Activation::Kind> &activations) {
+	assert(activations.size() == 1 || activations.size() + 1 == m_layers.size());
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
+		m_layers[layerNum].setActivation(activations[activations.size() == 1 ? 0 : layerNum - 1]);
 	}
+	m_weightVersion = InferenceCache::newVersion();
 }
 
 /* fills the passed vector of values with results from the output values. */
-void Net::getResults(vector<double> &resultVals) const {
+template <typename T>
+void BasicNet<T>::getResults(vector<double> &resultVals) const {
 	resultVals.clear();
-	for (unsigned n = 0; n < m_layers.back().size() - 1; ++n) {
-		resultVals.push_back(m_layers.back()[n].getOutputVal());  //fill result vector
+	for (unsigned n = 0; n < m_layers.back().size(); ++n) {
+		resultVals.push_back(m_layers.back().getOutputVal(n));  //fill result vector
 	}
 }
 
-/**/
-void Net::backProp(const vector<double> &targetVals) {
-	Layer &outputLayer = m_layers.back(); // Calculate overall net error (RMS of output neuron errors)
-	m_error = 0.0;
-	for (unsigned n = 0; n < outputLayer.size() - 1; ++n) {
-		double delta = targetVals[n] - outputLayer[n].getOutputVal();
-		m_error += delta * delta;
-	}
-	m_error /= outputLayer.size() - 1;    // get average error squared
-	m_error = sqrt(m_error);              // RMS
+/* inference only forward pass. row r of inputs starts every inputStride values, outputs gets numOutputs values per
+   row. the activations live in scratch (grown as needed, so it can be reused from batch to batch) and the net
+   itself is only read: no outputs, gradients or momentum are touched. */
+template <typename T>
+void BasicNet<T>::inferBatch(const double *inputs, unsigned inputStride, unsigned numRows, double *outputs, Scratch &scratch) const {
+	unsigned widest = 0;
+	for (unsigned layerNum = 0; layerNum < m_layers.size(); ++layerNum) widest = max(widest, m_layers[layerNum].size() + 1);
+	uint64_t half = uint64_t(numRows) * widest;
+	if (scratch.size() < 2 * half) scratch.resize(2 * half);
+	T *rows = scratch.data(), *nextRows = scratch.data() + half;
+	unsigned numInputs = m_layers.front().size();
+	for (unsigned r = 0; r < numRows; ++r) {     // the input layer's outputs are the inputs plus the bias neuron
+		copy(inputs + uint64_t(r) * inputStride, inputs + uint64_t(r) * inputStride + numInputs, rows + uint64_t(r) * (numInputs + 1));
+		rows[uint64_t(r) * (numInputs + 1) + numInputs] = 1.0;
+	}
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
+		const BasicLayer<T> &layer = m_layers[layerNum];
+		unsigned stride = layer.size() + 1;
+		layer.forwardRows(rows, layer.numInputs(), nextRows, stride, numRows);
+		for (unsigned r = 0; r < numRows; ++r) nextRows[uint64_t(r) * stride + layer.size()] = 1.0;
+		swap(rows, nextRows);
+	}
+	unsigned numOutputs = m_layers.back().size();
+	for (unsigned r = 0; r < numRows; ++r) {
+		copy(rows + uint64_t(r) * (numOutputs + 1), rows + uint64_t(r) * (numOutputs + 1) + numOutputs, outputs + uint64_t(r) * numOutputs);
+	}
+}
+
+/* calculates overall net error (RMS of output neuron errors) of one sample. */
+template <typename T>
+double BasicNet<T>::sampleError(const T *outputs, const double *targetVals) const {
+	unsigned numOutputs = m_layers.back().size();
+	double error = 0.0;
+	for (unsigned n = 0; n < numOutputs; ++n) {
+		double delta = targetVals[n] - outputs[n];
+		error += delta * delta;
+	}
+	error /= numOutputs;                  // get average error squared
+	return sqrt(error);                   // RMS
+}
+
+/* makes error the net's current error and folds it into the recent average. */
+template <typename T>
+void BasicNet<T>::recordError(double error) {
+	TrainingCounters::recordError(m_counters, error);
+	m_errorSum += error;
+	++m_errorCount;
+	m_error = error;
 	m_recentAverageError = 	              // Implement a recent average measurement
-		(m_recentAverageError * m_recentAverageSmoothingFactor + m_error)
-		/ (m_recentAverageSmoothingFactor + 1.0);
+		(m_recentAverageError * m_config.recentAverageSmoothingFactor + m_error)
+		/ (m_config.recentAverageSmoothingFactor + 1.0);
+}
+
+template <typename T>
+double BasicNet<T>::takeMeanError(void) {
+	double mean = m_errorCount > 0 ? m_errorSum / m_errorCount : 0.0;
+	m_errorSum = 0.0;
+	m_errorCount = 0;
+	return mean;
+}
+
+/**/
+template <typename T>
+void BasicNet<T>::backProp(const vector<double> &targetVals) {
+	PhaseTimer timer(m_counters);
+	BasicLayer<T> &outputLayer = m_layers.back();
+	TrainingCounters::addSamples(m_counters, 1);
+	recordError(sampleError(outputLayer.getOutputVals(), targetVals.data()));
 
 	// Calculate output layer gradients
-	for (unsigned n = 0; n < outputLayer.size() - 1; ++n) {
-		outputLayer[n].calcOutputGradients(targetVals[n]);
-	}
+	outputLayer.calcOutputGradients(targetVals);
 	// Calculate hidden layer gradients
 	for (unsigned layerNum = m_layers.size() - 2; layerNum > 0; --layerNum) {
-		Layer &hiddenLayer = m_layers[layerNum];
-		Layer &nextLayer = m_layers[layerNum + 1];
-		for (unsigned n = 0; n < hiddenLayer.size(); ++n) {
-			hiddenLayer[n].calcHiddenGradients(nextLayer);
+		m_layers[layerNum].calcHiddenGradients(m_layers[layerNum + 1]);
+	}
+	if (TrainingCounters::wantsGradientNorms(m_counters)) {
+		m_counters->gradientNorms.resize(m_layers.size() - 1);
+		for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
+			m_counters->gradientNorms[layerNum - 1] = m_layers[layerNum].sampleGradientNorm(m_layers[layerNum - 1]);
 		}
+		m_counters->wantGradientNorms = false;
 	}
+	timer.mark(TrainingCounters::BACKWARD);
 	// For all layers from outputs to first hidden layer,
 	// update connection weights
+	++m_updates;
 	for (unsigned layerNum = m_layers.size() - 1; layerNum > 0; --layerNum) {
-		Layer &layer = m_layers[layerNum];
-		Layer &prevLayer = m_layers[layerNum - 1];
-		for (unsigned n = 0; n < layer.size() - 1; ++n) {
-			layer[n].updateInputWeights(prevLayer);
+		m_layers[layerNum].updateInputWeights(m_layers[layerNum - 1], m_updates);
+	}
+	m_weightVersion = InferenceCache::newVersion();
+	timer.mark(TrainingCounters::UPDATE);
+}
+
+/* trains on numSamples rows at once. each row holds a sample's input values followed by its target values.
+   the whole batch is fed forward and back propagated together, the weight changes of every sample are
+   averaged and then applied in one optimizer update. a batch of one sample gives exactly the same result as
+   feedForward followed by backProp. */
+template <typename T>
+void BasicNet<T>::trainBatch(const double *samples, unsigned numSamples) {
+	TrainingCounters::addSamples(m_counters, numSamples);
+	computeGradients(samples, numSamples, numSamples);
+	for (unsigned r = 0; r < numSamples; ++r) recordError(m_sampleErrors[r]);
+	if (TrainingCounters::wantsGradientNorms(m_counters)) {
+		gradientNorms(vector<BasicNet *>(1, this), m_counters->gradientNorms);
+		m_counters->wantGradientNorms = false;
+	}
+	applyGradients();
+}
+
+/* feeds numSamples rows forward, back propagates them and adds their weight changes (averaged over batchSize
+   samples) to each layer's weight gradients. the weights themselves aren't touched and the errors are only
+   collected in m_sampleErrors, so several nets can work on slices of one batch. */
+template <typename T>
+void BasicNet<T>::computeGradients(const double *samples, unsigned numSamples, unsigned batchSize) {
+	assert(numSamples > 0);
+	PhaseTimer timer(m_counters);
+	unsigned numInputs = m_layers.front().size(), numOutputs = m_layers.back().size();
+	unsigned stride = numInputs + numOutputs;
+	for (unsigned layerNum = 0; layerNum < m_layers.size(); ++layerNum) {
+		m_layers[layerNum].resizeBatch(numSamples);
+	}
+	// Latch every sample's input values into its row of the input layer
+	for (unsigned r = 0; r < numSamples; ++r) {
+		copy(samples + r * stride, samples + r * stride + numInputs, m_layers[0].batchOutputRow(r));
+	}
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
+		m_layers[layerNum].feedForwardBatch(m_layers[layerNum - 1], numSamples);
+	}
+	timer.mark(TrainingCounters::FORWARD);
+	BasicLayer<T> &outputLayer = m_layers.back();
+	m_sampleErrors.resize(numSamples);
+	for (unsigned r = 0; r < numSamples; ++r) {
+		m_sampleErrors[r] = sampleError(outputLayer.batchOutputRow(r), samples + r * stride + numInputs);
+	}
+	outputLayer.calcOutputGradientsBatch(samples + numInputs, stride, numSamples);
+	for (unsigned layerNum = m_layers.size() - 2; layerNum > 0; --layerNum) {
+		m_layers[layerNum].calcHiddenGradientsBatch(m_layers[layerNum + 1], numSamples);
+	}
+	for (unsigned layerNum = m_layers.size() - 1; layerNum > 0; --layerNum) {
+		m_layers[layerNum].accumulateWeightGradients(m_layers[layerNum - 1], numSamples, batchSize);
+	}
+	for (unsigned layerNum = 0; layerNum < m_layers.size(); ++layerNum) {
+		m_layers[layerNum].copyBatchRowToOutputs(numSamples - 1); // getResults reports the last sample, like after feedForward
+	}
+	timer.mark(TrainingCounters::BACKWARD);
+}
+
+/* applies the accumulated weight gradients with one optimizer update per layer. */
+template <typename T>
+void BasicNet<T>::applyGradients(void) {
+	PhaseTimer timer(m_counters);
+	++m_updates;
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
+		m_layers[layerNum].applyWeightGradients(0, m_layers[layerNum].numWeights(), m_updates);
+	}
+	m_weightVersion = InferenceCache::newVersion();
+	timer.mark(TrainingCounters::UPDATE);
+}
+
+/* applies our accumulated weight gradients to another net's weights and optimizer state, without any locking.
+   the updates are counted in our own m_updates (the shared net's count would be one more race), the caller adds
+   them up afterwards, and marks its weights changed. */
+template <typename T>
+void BasicNet<T>::applyGradientsTo(BasicNet &shared) {
+	PhaseTimer timer(m_counters);
+	++m_updates;
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
+		m_layers[layerNum].applyWeightGradientsTo(shared.m_layers[layerNum], m_updates);
+	}
+	timer.mark(TrainingCounters::UPDATE);
+}
+
+/* sums the weight gradients of every replica, always in the same order, and applies them. the weights are split
+   into numParts slices so numParts threads can each reduce and update their own part at the same time, finishReduce
+   counts the update once they all have. */
+template <typename T>
+void BasicNet<T>::reduceGradients(const vector<BasicNet *> &replicas, unsigned part, unsigned numParts) {
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
+		BasicLayer<T> &layer = m_layers[layerNum];
+		unsigned begin = unsigned(uint64_t(layer.numWeights()) * part / numParts);
+		unsigned end = unsigned(uint64_t(layer.numWeights()) * (part + 1) / numParts);
+		for (unsigned i = 0; i < replicas.size(); ++i) {
+			layer.addWeightGradients(replicas[i]->m_layers[layerNum], begin, end);
 		}
+		layer.applyWeightGradients(begin, end, m_updates + 1);
 	}
 }
 
-void Net::feedForward(const vector<double> &inputVals) {
-	assert(inputVals.size() == m_layers[0].size() - 1);
+/* the norm of every layer's weight gradients accumulated by computeGradients, summed over the nets first. */
+template <typename T>
+void BasicNet<T>::gradientNorms(const vector<BasicNet *> &nets, vector<double> &norms) {
+	norms.resize(nets.front()->m_layers.size() - 1);
+	vector<const BasicLayer<T> *> parts(nets.size());
+	for (unsigned layerNum = 1; layerNum < nets.front()->m_layers.size(); ++layerNum) {
+		for (unsigned i = 0; i < nets.size(); ++i) parts[i] = &nets[i]->m_layers[layerNum];
+		norms[layerNum - 1] = BasicLayer<T>::weightGradientNorm(parts);
+	}
+}
+
+/* folds the sample errors of a replica's last computeGradients into our recent average error. */
+template <typename T>
+void BasicNet<T>::recordErrors(const BasicNet &replica) {
+	for (unsigned r = 0; r < replica.m_sampleErrors.size(); ++r) recordError(replica.m_sampleErrors[r]);
+}
+
+/* copies another net's weights (not its momentum) and which of them are pruned into this one, they must share the
+   topology. */
+template <typename T>
+void BasicNet<T>::copyWeights(const BasicNet &other) {
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
+		m_layers[layerNum].copyWeights(other.m_layers[layerNum]);
+	}
+	m_weightVersion = InferenceCache::newVersion();
+}
+
+template <typename T>
+void BasicNet<T>::feedForward(const vector<double> &inputVals) {
+	assert(inputVals.size() == m_layers[0].size());
+	PhaseTimer timer(m_counters);
 	// Assign (latch) the input values into the input neurons
 	for (unsigned i = 0; i < inputVals.size(); ++i) {
-		m_layers[0][i].setOutputVal(inputVals[i]);
+		m_layers[0].setOutputVal(i, inputVals[i]);
 	}
 
 	// forward propagate
 	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
-		Layer &prevLayer = m_layers[layerNum - 1];
-		for (unsigned n = 0; n < m_layers[layerNum].size() - 1; ++n) {
-			m_layers[layerNum][n].feedForward(prevLayer);
+		m_layers[layerNum].feedForward(m_layers[layerNum - 1]);
+	}
+	timer.mark(TrainingCounters::FORWARD);
+}
+
+/* the number of neurons in every layer, not counting the bias neurons. */
+template <typename T>
+vector<unsigned> BasicNet<T>::getTopology(void) const {
+	vector<unsigned> topology;
+	for (unsigned layerNum = 0; layerNum < m_layers.size(); ++layerNum) topology.push_back(m_layers[layerNum].size());
+	return topology;
+}
+
+/* magnitude pruning: every layer's weights below threshold in magnitude are zeroed and stay zero from then on (see
+   BasicLayer::prune). the outputs change, so the net gets a new weight version. */
+template <typename T>
+void BasicNet<T>::prune(double threshold) {
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) m_layers[layerNum].prune(T(threshold));
+	m_weightVersion = InferenceCache::newVersion();
+}
+
+/* every layer is pruned to the same sparsity, so no layer is left with too few weights to pass anything on. */
+template <typename T>
+void BasicNet<T>::pruneToSparsity(double sparsity) {
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) m_layers[layerNum].pruneToSparsity(sparsity);
+	m_weightVersion = InferenceCache::newVersion();
+}
+
+template <typename T>
+double BasicNet<T>::getSparsity(void) const {
+	uint64_t pruned = 0, prunable = 0;
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
+		pruned += m_layers[layerNum].numPruned();
+		prunable += m_layers[layerNum].numPrunable();
+	}
+	return prunable > 0 ? double(pruned) / prunable : 0.0;
+}
+
+/* the "OPTM" checkpoint section: which optimizer the delta weights belong to and how many updates it has made,
+   followed for RMSPROP and ADAM by every layer's squared gradient averages as doubles. a checkpoint without it
+   was saved by a momentum net. the "ACTV" section holds the layers' activations, without it they are all tanh. */
+struct OptimizerSection {
+	uint32_t optimizer;    // NetConfig::Optimizer
+	uint32_t reserved;
+	uint64_t updates;
+};
+
+/* the "CSR " section, only written once something is pruned, says which weights are: every layer after the input
+   layer gets a uint32 count of the weights it kept. a layer that kept them all stops there, any other is followed by
+   its compressed sparse rows, numNeurons + 1 uint32 row starts and then the uint32 column of every kept weight, row
+   by row. only the pattern is stored sparse: the values stay in the dense weight arrays, zero where pruned, since
+   every checkpoint must hold those arrays whole and readers that skip the section (StaticNet, older builds) load
+   the pruned net from them as it is. */
+template <typename T>
+static void appendPruning(const BasicLayer<T> &layer, vector<uint32_t> &words) {
+	words.push_back(layer.numWeights() - layer.numPruned());
+	if (layer.numPruned() == 0) return;
+	size_t rowStarts = words.size();
+	words.resize(rowStarts + layer.size() + 1);
+	words[rowStarts] = 0;
+	for (unsigned n = 0; n < layer.size(); ++n) {
+		for (unsigned i = 0; i < layer.numInputs(); ++i) {
+			if (!layer.isPruned(n, i)) words.push_back(i);
 		}
+		words[rowStarts + n + 1] = uint32_t(words.size() - rowStarts - layer.size() - 1);
 	}
 }
 
-void Net::writeNet(const vector<unsigned> & topology) {
-	//make sure every layer is accurate with the topology.
-	for (unsigned c = 0; c < topology.size(); ++c) assert(m_layers.at(c).size() - 1 == topology.at(c));
-	ofstream outFile("learnDataWeights.txt");
-	outFile.seekp(0, ios::beg);
-	for (unsigned i = 0; i < topology.size(); ++i) {
-		for (unsigned j = 0; j < topology.at(i); ++j) {
-			for (unsigned k = 0; k < m_layers.at(i).at(j).getOutputWeights().size(); ++k) {
-				outFile << "W: " << m_layers.at(i).at(j).getOutputWeights().at(k).weight << "\n"
-					<< "DW: " << m_layers.at(i).at(j).getOutputWeights().at(k).deltaWeight << "\n";
+/* the pruned flags of every layer from a "CSR " section, false if it is damaged. */
+template <typename T>
+static bool readPruning(const char *data, uint64_t bytes, const vector<BasicLayer<T> > &layers, vector<vector<uint8_t> > &pruned) {
+	if (bytes % sizeof(uint32_t) != 0) return false;
+	vector<uint32_t> words(bytes / sizeof(uint32_t));
+	memcpy(words.data(), data, bytes);
+	size_t next = 0;
+	pruned.assign(layers.size(), vector<uint8_t>());
+	for (unsigned layerNum = 1; layerNum < layers.size(); ++layerNum) {
+		const BasicLayer<T> &layer = layers[layerNum];
+		if (next == words.size()) return false;
+		uint32_t kept = words[next++];
+		if (kept == layer.numWeights()) continue;
+		if (kept > layer.numWeights() || words.size() - next < uint64_t(layer.size()) + 1 + kept) return false;
+		const uint32_t *rowStarts = &words[next], *columns = rowStarts + layer.size() + 1;
+		if (rowStarts[0] != 0 || rowStarts[layer.size()] != kept) return false;
+		pruned[layerNum].assign(layer.numWeights(), 1);
+		for (unsigned n = 0; n < layer.size(); ++n) {
+			if (rowStarts[n + 1] < rowStarts[n] || rowStarts[n + 1] > kept) return false;
+			for (uint32_t k = rowStarts[n]; k < rowStarts[n + 1]; ++k) {
+				if (columns[k] >= layer.numInputs() || (k > rowStarts[n] && columns[k] <= columns[k - 1])) return false;
+				pruned[layerNum][uint64_t(n) * layer.numInputs() + columns[k]] = 0;
 			}
 		}
+		next += layer.size() + 1 + kept;
 	}
-	outFile.close();
+	return next == words.size();
 }
 
-void Net::readNet(vector<unsigned> & topology) {
-	for (unsigned c = 0; c < topology.size(); ++c) assert(this->m_layers.at(c).size() - 1 == topology.at(c));
-	vector<double> tWeights, tDeltaWeights;
-	ifstream inFile("learnDataWeights.txt");
-	unsigned lCount = 0;
-	while (!inFile.eof()) {
-		string line;
-		getline(inFile, line);
-		stringstream ss(line);
-		string label;
-		ss >> label;
-		if (label.compare("W:") == 0) {
-			double oneValue;
-			while (ss >> oneValue) {
-				tWeights.push_back(oneValue);
-			}
+/* saves a binary checkpoint holding the exact weights and optimizer state, see writeCheckpoint. */
+template <typename T>
+void BasicNet<T>::writeNet(const string &fileName) const {
+	vector<const T *> arrays;
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
+		arrays.push_back(m_layers[layerNum].getWeights());
+		arrays.push_back(m_layers[layerNum].getDeltaWeights());
+	}
+	OptimizerSection state = { uint32_t(m_config.optimizer), 0, m_updates };
+	vector<char> bytes(reinterpret_cast<const char *>(&state), reinterpret_cast<const char *>(&state) + sizeof(state));
+	if (m_config.adaptive()) {
+		for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
+			const BasicLayer<T> &layer = m_layers[layerNum];
+			vector<double> squares(layer.getSquares(), layer.getSquares() + layer.numWeights());
+			bytes.insert(bytes.end(), reinterpret_cast<const char *>(squares.data()), reinterpret_cast<const char *>(squares.data() + squares.size()));
+		}
+	}
+	vector<uint32_t> activations(m_layers.size() - 1);
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) activations[layerNum - 1] = m_layers[layerNum].getActivation();
+	vector<CheckpointSection> sections;
+	CheckpointSection optimizerSection = { "OPTM", bytes.data(), bytes.size() };
+	CheckpointSection activationSection = { "ACTV", reinterpret_cast<const char *>(activations.data()), activations.size() * sizeof(uint32_t) };
+	sections.push_back(optimizerSection);
+	sections.push_back(activationSection);
+	vector<uint32_t> pruning;
+	if (getSparsity() > 0.0) {
+		for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) appendPruning(m_layers[layerNum], pruning);
+		CheckpointSection pruningSection = { "CSR ", reinterpret_cast<const char *>(pruning.data()), pruning.size() * sizeof(uint32_t) };
+		sections.push_back(pruningSection);
+	}
+	writeCheckpoint(fileName, getTopology(), arrays, sections);
+}
+
+/* reads the topology stored in a checkpoint, false if fileName isn't a checkpoint. */
+template <typename T>
+bool BasicNet<T>::readTopology(const string &fileName, vector<unsigned> &topology) {
+	return readCheckpointTopology(fileName, topology);
+}
+
+/* loads a checkpoint saved by writeNet, or a text file saved by exportText. the checkpoint is mapped and checked
+   before anything is copied, so a damaged or mismatched file throws and leaves the net as it was. the net keeps
+   its own config: the optimizer state is only taken over if it was saved by the same optimizer, otherwise it
+   starts from nothing. */
+template <typename T>
+void BasicNet<T>::readNet(const string &fileName) {
+	MappedFile file;
+	vector<CheckpointSection> sections;
+	const double *weights = mapCheckpoint(file, fileName, getTopology(), &sections);
+	if (weights == NULL) {
+		importText(fileName);
+		return;
+	}
+	OptimizerSection state = { uint32_t(NetConfig::MOMENTUM), 0, 0 };
+	const CheckpointSection *optimizer = findSection(sections, "OPTM");
+	if (optimizer) {
+		if (optimizer->bytes < sizeof(state)) throw runtime_error(fileName + " has a damaged optimizer section");
+		memcpy(&state, optimizer->data, sizeof(state));
+	}
+	bool keepState = state.optimizer == uint32_t(m_config.optimizer);
+	const double *squares = NULL;
+	if (keepState && m_config.adaptive()) {
+		uint64_t numWeights = 0;
+		for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) numWeights += m_layers[layerNum].numWeights();
+		if (optimizer->bytes != sizeof(state) + numWeights * sizeof(double)) throw runtime_error(fileName + " has a damaged optimizer section");
+		squares = reinterpret_cast<const double *>(optimizer->data + sizeof(state));
+	}
+	vector<Activation::Kind> activations(m_layers.size() - 1, Activation::TANH);
+	const CheckpointSection *activationSection = findSection(sections, "ACTV");
+	if (activationSection && !Activation::readSection(activationSection->data, activationSection->bytes, m_layers.size() - 1, activations)) {
+		throw runtime_error(fileName + " has a damaged activation section");
+	}
+	vector<vector<uint8_t> > pruned(m_layers.size());
+	const CheckpointSection *pruningSection = findSection(sections, "CSR ");
+	if (pruningSection && !readPruning(pruningSection->data, pruningSection->bytes, m_layers, pruned)) {
+		throw runtime_error(fileName + " has a damaged pruning section");
+	}
+	for (unsigned layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
+		BasicLayer<T> &layer = m_layers[layerNum];
+		layer.setWeights(weights, weights + layer.numWeights());
+		weights += 2 * uint64_t(layer.numWeights());
+		if (!keepState) layer.clearState();
+		else if (squares) {
+			layer.setSquares(squares);
+			squares += layer.numWeights();
 		}
-		string line2;
-		getline(inFile, line2);
-		stringstream ss2(line2);
-		string label2;
-		ss2 >> label2;
-		if (label2.compare("DW:") == 0) {
-			double oneValue2;
-			while (ss2 >> oneValue2) {
-				tDeltaWeights.push_back(oneValue2);
+		layer.setPruned(pruned[layerNum].empty() ? NULL : pruned[layerNum].data());
+	}
+	m_updates = keepState ? state.updates : 0;
+	setActivations(activations);
+}
+
+/* writes the weights as W:/DW: text pairs, the format older builds saved to learnDataWeights.txt. neuron j of layer
+   i feeds neuron k of layer i + 1 (the bias weights aren't part of this format). */
+template <typename T>
+void BasicNet<T>::exportText(const string &fileName) const {
+	ofstream outFile(fileName.c_str());
+	outFile << setprecision(17);                          // enough digits to read back the exact same doubles
+	for (unsigned i = 0; i + 1 < m_layers.size(); ++i) {
+		const BasicLayer<T> &nextLayer = m_layers[i + 1];
+		for (unsigned j = 0; j < m_layers[i].size(); ++j) {
+			for (unsigned k = 0; k < nextLayer.size(); ++k) {
+				outFile << "W: " << nextLayer.getWeight(k, j) << "\n"
+					<< "DW: " << nextLayer.getDeltaWeight(k, j) << "\n";
 			}
 		}
-		++lCount;
 	}
-	assert(tWeights.size() == tDeltaWeights.size());
+	if (!outFile) throw runtime_error("couldn't write " + fileName);
+}
+
+/* reads a file written by exportText. */
+template <typename T>
+void BasicNet<T>::importText(const string &fileName) {
+	vector<double> tWeights, tDeltaWeights;
+	ifstream inFile(fileName.c_str());
+	string line, label;
+	while (getline(inFile, line)) {
+		stringstream ss(line);
+		double oneValue;
+		if (!(ss >> label >> oneValue)) continue;
+		if (label == "W:") tWeights.push_back(oneValue);
+		else if (label == "DW:") tDeltaWeights.push_back(oneValue);
+	}
+	uint64_t expected = 0;
+	for (unsigned i = 0; i + 1 < m_layers.size(); ++i) expected += uint64_t(m_layers[i].size()) * m_layers[i + 1].size();
+	if (tWeights.size() != expected || tDeltaWeights.size() != expected) {
+		throw runtime_error(fileName + " doesn't hold the " + to_string(expected) + " weights a " + topologyString(getTopology()) + " net needs");
+	}
 	unsigned nCount = 0;
-	for (unsigned i = 0; i < topology.size(); ++i) {
-		for (unsigned j = 0; j < topology.at(i); ++j) {
-			if (i + 1 >= topology.size()) break;
-			for (unsigned k = 0; k < topology.at(i + 1); ++k) {
-				m_layers.at(i).at(j).getOutputWeights().at(k).weight = tWeights.at(nCount);
-				m_layers.at(i).at(j).getOutputWeights().at(k).deltaWeight = tDeltaWeights.at(nCount);
-				cout << "count: " << nCount << " weight: " << m_layers.at(i).at(j).getOutputWeights().at(k).weight
-					<< " delta: " << m_layers.at(i).at(j).getOutputWeights().at(k).deltaWeight << endl;
+	for (unsigned i = 0; i + 1 < m_layers.size(); ++i) {
+		BasicLayer<T> &nextLayer = m_layers[i + 1];
+		for (unsigned j = 0; j < m_layers[i].size(); ++j) {
+			for (unsigned k = 0; k < nextLayer.size(); ++k) {
+				nextLayer.weight(k, j) = tWeights[nCount];
+				nextLayer.deltaWeight(k, j) = tDeltaWeights[nCount];
 				++nCount;
 			}
 		}
+		nextLayer.setPruned(NULL);   // the text format doesn't know about pruning
 	}
-	inFile.close();
-}
\ No newline at end of file
+	m_weightVersion = InferenceCache::newVersion();
+}
+
+template class BasicNet<double>;
+template class BasicNet<float>;
@@ -1,20 +1,79 @@
 #pragma once
 #ifndef Net_H
 #define Net_H
-#include "Neuron.h"
-class Net {
+#include "Layer.h"
+#include "Checkpoint.h"
+#include "MappedFile.h"
+#include "Telemetry.h"
+#include "InferenceCache.h"
+
+/* a fully connected network of BasicLayer<T>. inputs, targets, results and errors are double whatever T is. */
+template <typename T>
+class BasicNet {
 public:
-	Net(const vector<unsigned> &);
+	typedef vector<T> Scratch; // what inferBatch keeps its activations in
+	BasicNet(const vector<unsigned> &topology, const NetConfig &config = NetConfig());
 	void feedForward(const vector<double> &);
 	void backProp(const vector<double> &);
+	void trainBatch(const double *samples, unsigned numSamples);
+	// the two halves of trainBatch, for trainers that combine the gradients of several nets
+	void computeGradients(const double *samples, unsigned numSamples, unsigned batchSize);
+	void applyGradients(void);
+	void applyGradientsTo(BasicNet &shared);
+	void reduceGradients(const vector<BasicNet *> &replicas, unsigned part, unsigned numParts);
+	void finishReduce(void) { ++m_updates; m_weightVersion = InferenceCache::newVersion(); } // once every part of an update has been reduced
+	void recordErrors(const BasicNet &replica);
+	void copyWeights(const BasicNet &other);
 	void getResults(vector<double> &) const;
+	void inferBatch(const double *inputs, unsigned inputStride, unsigned numRows, double *outputs, Scratch &scratch) const;
 	double getRecentAverageError(void) const { return m_recentAverageError; }
-	void writeNet(const vector<unsigned> &);
-	void readNet(vector<unsigned> &);
+	double takeMeanError(void);   // mean RMS error of the samples trained on since the last call, then starts over
+	unsigned getNumInputs(void) const { return m_layers.front().size(); }
+	unsigned getNumOutputs(void) const { return m_layers.back().size(); }
+	unsigned getNumLayers(void) const { return m_layers.size(); }
+	const BasicLayer<T> &getLayer(unsigned layerNum) const { return m_layers[layerNum]; }
+	vector<unsigned> getTopology(void) const;
+	vector<Activation::Kind> getActivations(void) const;              // of every layer after the input layer
+	void setActivations(const vector<Activation::Kind> &activations); // one per layer after the input layer, or one for all
+	const NetConfig &getConfig(void) const { return m_config; }
+	void setConfig(const NetConfig &config);
+	uint64_t getUpdates(void) const { return m_updates; }   // weight updates made so far with the current optimizer
+	void setUpdates(uint64_t updates) { m_updates = updates; }
+	// changes whenever the weights or activations do (training, readNet, setActivations), InferenceCache entries are
+	// stamped with it. copyWeights starts a new one and never reads the other net's, which the sync trainer's workers
+	// rely on: they copy the shared net while the update that gives it its next version is finishing
+	uint64_t getWeightVersion(void) const { return m_weightVersion; }
+	void markWeightsChanged(void) { m_weightVersion = InferenceCache::newVersion(); } // after writes from elsewhere, like applyGradientsTo
+	void writeNet(const string &fileName) const;   // binary checkpoint, see Checkpoint.h. throws runtime_error
+	// a checkpoint or an exportText file of the same topology, the checkpoint's activations replace ours. throws runtime_error
+	void readNet(const string &fileName);
+	void exportText(const string &fileName) const; // the W:/DW: text format
+	static bool readTopology(const string &fileName, vector<unsigned> &topology); // false if the file isn't a checkpoint
+	// magnitude pruning of every layer's weights, bias weights excepted (see BasicLayer::prune). pruned weights stay
+	// zero through any further training and checkpoints keep them pruned
+	void prune(double threshold);              // the weights smaller than threshold
+	void pruneToSparsity(double sparsity);     // the smallest weights of each layer, up to that fraction of them
+	double getSparsity(void) const;            // the pruned fraction of the weights that can be pruned
+	// telemetry: the net adds its phase times, samples and errors to counters (NULL, the default, turns that off).
+	// copies of a net share its counters until they are given their own
+	void setCounters(TrainingCounters *counters) { m_counters = counters; }
+	TrainingCounters *getCounters(void) const { return m_counters; }
+	static void gradientNorms(const vector<BasicNet *> &nets, vector<double> &norms); // of the nets' summed batch gradients
 private:
-	vector<Layer> m_layers;
+	double sampleError(const T *outputs, const double *targetVals) const;
+	void recordError(double error);
+	void importText(const string &fileName);
+	vector<BasicLayer<T> > m_layers;
+	vector<double> m_sampleErrors; // RMS error of every sample in the last computeGradients
 	double m_error;
 	double m_recentAverageError;
-	static double m_recentAverageSmoothingFactor;
+	double m_errorSum;             // since the last takeMeanError
+	uint64_t m_errorCount;
+	NetConfig m_config;
+	uint64_t m_updates;            // the t of Adam's corrections
+	uint64_t m_weightVersion;
+	TrainingCounters *m_counters;
 };
-#endif
\ No newline at end of file
+typedef BasicNet<double> Net;
+typedef BasicNet<float> FloatNet;
+#endif
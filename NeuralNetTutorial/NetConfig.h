@@ -0,0 +1,43 @@
+#pragma once
+#ifndef NetConfig_H
+#define NetConfig_H
+#include "Globalfuncs.h"
+using namespace std;
+
+/* how a net learns. every net has its own, so nets with different settings can train side by side.
+   the optimizer is the rule a layer's weights are updated with, from its gradient g (the mean over the batch):
+     MOMENTUM  dw = eta * g + alpha * dw, w += dw                      (what the net always did)
+     NESTEROV  v = eta * g + alpha * v, w += eta * g + alpha * v       (momentum looking one step ahead)
+     RMSPROP   s = beta2 * s + (1 - beta2) * g^2, w += eta * g / (sqrt(s) + epsilon)
+     ADAM      m = beta1 * m + (1 - beta1) * g, s as RMSPROP, w += eta * m^ / (sqrt(s^) + epsilon), where m^ and s^
+               are m and s divided by 1 - beta^t after t updates (so the first updates aren't too small)
+   the adaptive ones want a much smaller eta than the momentum rules, see defaultEta. */
+struct NetConfig {
+	enum Optimizer { MOMENTUM, NESTEROV, RMSPROP, ADAM };
+	double eta;                           // [0.0..1.0] overall net training rate
+	double alpha;                         // [0.0..n] multiplier of the last weight change (momentum)
+	double recentAverageSmoothingFactor;  // number of training samples getRecentAverageError averages over
+	Optimizer optimizer;
+	double beta1;                         // ADAM: decay of the gradient average
+	double beta2;                         // RMSPROP and ADAM: decay of the squared gradient average
+	double epsilon;                       // keeps their divisions finite
+	NetConfig() : eta(0.33), alpha(0.55), recentAverageSmoothingFactor(100.0), optimizer(MOMENTUM), beta1(0.9), beta2(0.999), epsilon(1e-8) {}
+	NetConfig(double eta, double alpha, double smoothing)
+		: eta(eta), alpha(alpha), recentAverageSmoothingFactor(smoothing), optimizer(MOMENTUM), beta1(0.9), beta2(0.999), epsilon(1e-8) {}
+	bool adaptive(void) const { return optimizer == RMSPROP || optimizer == ADAM; }   // keeps a squared gradient average
+	static double defaultEta(Optimizer optimizer) { return optimizer == RMSPROP || optimizer == ADAM ? 0.01 : 0.33; }
+	static const char *optimizerName(Optimizer optimizer) {
+		static const char *names[] = { "momentum", "nesterov", "rmsprop", "adam" };
+		return names[optimizer];
+	}
+	static bool parseOptimizer(const string &name, Optimizer &optimizer) {   // the names above, any case
+		for (unsigned o = MOMENTUM; o <= ADAM; ++o) {
+			string upperName = optimizerName(Optimizer(o)), upperWanted = name;
+			cap(upperName);
+			cap(upperWanted);
+			if (upperName == upperWanted) { optimizer = Optimizer(o); return true; }
+		}
+		return false;
+	}
+};
+#endif // !NetConfig_H
@@ -0,0 +1,160 @@
+#include "ParallelTrainer.h"
+
+/* blocks threads until all of them have called wait(), then lets them all continue. reusable. */
+template <typename T>
+class BasicParallelTrainer<T>::Barrier {
+public:
+	Barrier(unsigned count) : m_count(count), m_waiting(0), m_generation(0) {}
+	void wait(void) {
+		unique_lock<mutex> lock(m_mutex);
+		unsigned generation = m_generation;
+		if (++m_waiting == m_count) {
+			m_waiting = 0;
+			++m_generation;
+			m_released.notify_all();
+		}
+		else {
+			m_released.wait(lock, [&] { return generation != m_generation; });
+		}
+	}
+private:
+	mutex m_mutex;
+	condition_variable m_released;
+	unsigned m_count, m_waiting, m_generation;
+};
+
+/* the replicas are copies of the net, so making them doesn't draw any random weights. */
+template <typename T>
+BasicParallelTrainer<T>::BasicParallelTrainer(BasicNet<T> &net, unsigned numThreads, Mode mode, unsigned batchSize)
+	: m_net(net), m_numThreads(max(1u, numThreads)), m_mode(mode), m_batchSize(max(1u, batchSize)),
+	  m_sampleSize(net.getNumInputs() + net.getNumOutputs()), m_replicas(m_numThreads, net), m_shardSizes(m_numThreads),
+	  m_replicaCounters(m_numThreads), m_gradientNorms(false) {
+	for (unsigned t = 0; t < m_numThreads; ++t) m_replicaPtrs.push_back(&m_replicas[t]);
+}
+
+bool ParallelTrainerBase::parseMode(const string &name, Mode &mode) {
+	string upperName = name;
+	cap(upperName);
+	if (upperName == "SYNC") mode = SYNC;
+	else if (upperName == "HOGWILD") mode = HOGWILD;
+	else return false;
+	return true;
+}
+
+/* runs the workers over numSamples rows and waits for them to finish. */
+template <typename T>
+void BasicParallelTrainer<T>::train(const double *samples, unsigned numSamples) {
+	if (numSamples == 0) return;
+	TrainingCounters *counters = m_net.getCounters();
+	for (unsigned t = 0; t < m_numThreads; ++t) {
+		m_replicas[t].setCounters(counters ? &m_replicaCounters[t] : NULL);
+		if (counters) m_replicaCounters[t].timing = counters->timing;
+	}
+	m_gradientNorms = TrainingCounters::wantsGradientNorms(counters);
+	uint64_t updates = m_net.getUpdates();
+	for (unsigned t = 0; t < m_numThreads; ++t) m_replicas[t].setUpdates(updates);   // hogwild workers count their own
+	Barrier barrier(m_numThreads);
+	vector<thread> workers;
+	for (unsigned t = 0; t < m_numThreads; ++t) {
+		if (m_mode == SYNC) workers.push_back(thread(&BasicParallelTrainer::syncWorker, this, t, samples, numSamples, ref(barrier)));
+		else workers.push_back(thread(&BasicParallelTrainer::hogwildWorker, this, t, samples, numSamples));
+	}
+	for (unsigned t = 0; t < workers.size(); ++t) workers[t].join();
+	if (m_mode == HOGWILD) {
+		for (unsigned t = 0; t < m_numThreads; ++t) {
+			m_net.recordErrors(m_replicas[t]); // the last mini-batch of every worker
+			m_net.setUpdates(m_net.getUpdates() + m_replicas[t].getUpdates() - updates);
+		}
+		m_net.markWeightsChanged();           // the workers wrote to the weights without the net knowing
+	}
+	if (counters) {
+		TrainingCounters::addSamples(counters, numSamples);
+		for (unsigned t = 0; t < m_numThreads; ++t) counters->addTicks(m_replicaCounters[t]);
+	}
+}
+
+/* one step covers batchSize samples per worker. the shared net is only read while the workers compute and only
+   written (each worker updating its own slice of the weights) between the two barriers. */
+template <typename T>
+void BasicParallelTrainer<T>::syncWorker(unsigned t, const double *samples, unsigned numSamples, Barrier &barrier) {
+	BasicNet<T> &replica = m_replicas[t];
+	unsigned stepSize = m_batchSize * m_numThreads;
+	for (unsigned start = 0; start < numSamples; start += stepSize) {
+		unsigned count = min(stepSize, numSamples - start);
+		unsigned begin = start + unsigned(uint64_t(count) * t / m_numThreads);
+		unsigned end = start + unsigned(uint64_t(count) * (t + 1) / m_numThreads);
+		m_shardSizes[t] = end - begin;
+		if (end > begin) {
+			replica.copyWeights(m_net);
+			replica.computeGradients(samples + uint64_t(begin) * m_sampleSize, end - begin, count);
+		}
+		barrier.wait();
+		if (m_gradientNorms && start == 0) {      // before the reduce starts moving the replicas' gradients
+			if (t == 0) {
+				BasicNet<T>::gradientNorms(m_replicaPtrs, m_net.getCounters()->gradientNorms);
+				m_net.getCounters()->wantGradientNorms = false;
+			}
+			barrier.wait();
+		}
+		PhaseTimer timer(replica.getCounters());
+		m_net.reduceGradients(m_replicaPtrs, t, m_numThreads);
+		timer.mark(TrainingCounters::UPDATE);
+		if (t == 0) {
+			for (unsigned w = 0; w < m_numThreads; ++w) {
+				if (m_shardSizes[w] > 0) m_net.recordErrors(m_replicas[w]);
+			}
+		}
+		barrier.wait();
+		if (t == 0) m_net.finishReduce();   // nobody reads the count or the version again before the next step's first barrier
+	}
+}
+
+/* every worker walks its own contiguous slice of the samples. reading and updating the shared weights races with
+   the other workers on purpose: a lost or stale update only adds a little noise to the gradient. */
+template <typename T>
+void BasicParallelTrainer<T>::hogwildWorker(unsigned t, const double *samples, unsigned numSamples) {
+	BasicNet<T> &replica = m_replicas[t];
+	unsigned begin = unsigned(uint64_t(numSamples) * t / m_numThreads);
+	unsigned end = unsigned(uint64_t(numSamples) * (t + 1) / m_numThreads);
+	for (unsigned start = begin; start < end; start += m_batchSize) {
+		unsigned count = min(m_batchSize, end - start);
+		replica.copyWeights(m_net);
+		replica.computeGradients(samples + uint64_t(start) * m_sampleSize, count, count);
+		if (m_gradientNorms && t == 0 && start == begin) {
+			BasicNet<T>::gradientNorms(vector<BasicNet<T> *>(1, &replica), m_net.getCounters()->gradientNorms);
+			m_net.getCounters()->wantGradientNorms = false;
+		}
+		replica.applyGradientsTo(m_net);
+	}
+}
+
+/* trains a fresh copy of prototype on the same samples with 1, 2, 4 ... maxThreads workers and prints the
+   throughput of each run, its speedup over one thread and its efficiency (speedup / threads). */
+template <typename T>
+void BasicParallelTrainer<T>::scalingReport(const BasicNet<T> &prototype, const double *samples, unsigned numSamples,
+	unsigned maxThreads, Mode mode, unsigned batchSize, ostream &out) {
+	vector<unsigned> threadCounts;
+	for (unsigned t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+	threadCounts.push_back(max(1u, maxThreads));
+	out << (mode == SYNC ? "sync" : "hogwild") << " training, batch " << batchSize << ", " << numSamples << " samples\n"
+		<< setw(8) << "threads" << setw(16) << "samples/sec" << setw(10) << "speedup" << setw(12) << "efficiency" << setw(14) << "final error" << "\n";
+	double baseRate = 0.0;
+	for (unsigned i = 0; i < threadCounts.size(); ++i) {
+		BasicNet<T> net(prototype);
+		net.setCounters(NULL);                    // the runs aren't part of the net's own training
+		BasicParallelTrainer trainer(net, threadCounts[i], mode, batchSize);
+		chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+		trainer.train(samples, numSamples);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+		double rate = numSamples / max(seconds, 1e-9);
+		if (i == 0) baseRate = rate;
+		double speedup = rate / baseRate;
+		out << setw(8) << threadCounts[i] << setw(16) << fixed << setprecision(0) << rate
+			<< setw(10) << setprecision(2) << speedup << setw(11) << setprecision(0) << 100.0 * speedup / threadCounts[i] << "%"
+			<< setw(14) << setprecision(6) << net.getRecentAverageError() << "\n";
+		out.unsetf(ios::fixed);
+	}
+}
+
+template class BasicParallelTrainer<double>;
+template class BasicParallelTrainer<float>;
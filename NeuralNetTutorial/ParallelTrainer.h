@@ -0,0 +1,41 @@
+#pragma once
+#ifndef ParallelTrainer_H
+#define ParallelTrainer_H
+#include "Net.h"
+
+/* trains one Net with several worker threads. every worker owns a replica of the net (its own activations and
+   gradients) and takes a slice of the samples.
+   SYNC:    each step hands batchSize samples to every worker, the workers' gradients are summed in a fixed order
+            and applied to the shared net in one optimizer update. the result only depends on the thread count.
+   HOGWILD: every worker runs its own mini-batches and applies its updates straight to the shared weights with
+            no locking at all. updates can race and overwrite each other, which trades determinism for speed. */
+class ParallelTrainerBase {
+public:
+	enum Mode { SYNC, HOGWILD };
+	static bool parseMode(const string &name, Mode &mode);   // "sync" or "hogwild", any case
+};
+
+template <typename T>
+class BasicParallelTrainer : public ParallelTrainerBase {
+public:
+	BasicParallelTrainer(BasicNet<T> &net, unsigned numThreads, Mode mode, unsigned batchSize);
+	void train(const double *samples, unsigned numSamples); // same row layout as Net::trainBatch
+	static void scalingReport(const BasicNet<T> &prototype, const double *samples, unsigned numSamples,
+		unsigned maxThreads, Mode mode, unsigned batchSize, ostream &out);
+private:
+	class Barrier;
+	void syncWorker(unsigned t, const double *samples, unsigned numSamples, Barrier &barrier);
+	void hogwildWorker(unsigned t, const double *samples, unsigned numSamples);
+	BasicNet<T> &m_net;
+	unsigned m_numThreads;
+	Mode m_mode;
+	unsigned m_batchSize;
+	unsigned m_sampleSize;           // doubles per sample row
+	vector<BasicNet<T> > m_replicas; // one per worker
+	vector<BasicNet<T> *> m_replicaPtrs;
+	vector<unsigned> m_shardSizes;   // samples each worker got in the current sync step
+	vector<TrainingCounters> m_replicaCounters; // each worker times its own phases, summed into the net's after train
+	bool m_gradientNorms;            // the net's counters asked for gradient norms when train started
+};
+typedef BasicParallelTrainer<double> ParallelTrainer;
+#endif // !ParallelTrainer_H
@@ -0,0 +1,137 @@
+#include "QuantizedNet.h"
+#include "Kernels.h"
+
+static const unsigned ROW_BLOCK = 8;   // samples sharing each pass over a weight row, like the float layers
+
+/* the scale of each layer is picked so its largest weight becomes +-127, the bias column stays float. */
+template <typename T>
+QuantizedNet::QuantizedNet(const BasicNet<T> &net) : m_numInputs(net.getNumInputs()), m_weightVersion(InferenceCache::newVersion()) {
+	for (unsigned layerNum = 1; layerNum < net.getNumLayers(); ++layerNum) {
+		const BasicLayer<T> &source = net.getLayer(layerNum);
+		QuantizedLayer layer;
+		layer.numNeurons = source.size();
+		layer.numInputs = source.numInputs() - 1;
+		layer.activation = source.getActivation();
+		double largest = 0.0;
+		for (unsigned n = 0; n < layer.numNeurons; ++n) {
+			for (unsigned i = 0; i < layer.numInputs; ++i) largest = max(largest, fabs(double(source.getWeight(n, i))));
+		}
+		layer.scale = largest > 0.0 ? float(largest / 127.0) : 1.0f;
+		layer.weights.resize(uint64_t(layer.numNeurons) * layer.numInputs);
+		layer.biases.resize(layer.numNeurons);
+		for (unsigned n = 0; n < layer.numNeurons; ++n) {
+			for (unsigned i = 0; i < layer.numInputs; ++i) {
+				double q = floor(source.getWeight(n, i) / layer.scale + 0.5);
+				layer.weights[uint64_t(n) * layer.numInputs + i] = int8_t(min(127.0, max(-127.0, q)));
+			}
+			layer.biases[n] = float(source.getWeight(n, layer.numInputs));
+		}
+		m_layers.push_back(layer);
+	}
+}
+
+/* symmetric per row quantization: the largest magnitude in the row becomes +-127. */
+void QuantizedNet::quantizeRow(const float *values, unsigned count, int8_t *quantized, float &scale) {
+	float largest = 0.0f;
+	for (unsigned i = 0; i < count; ++i) largest = max(largest, fabs(values[i]));
+	scale = largest > 0.0f ? largest / 127.0f : 1.0f;
+	float inverse = 1.0f / scale;
+	for (unsigned i = 0; i < count; ++i) quantized[i] = int8_t(floor(values[i] * inverse + 0.5f));
+}
+
+void QuantizedNet::inferBatch(const double *inputs, unsigned inputStride, unsigned numRows, double *outputs, Scratch &scratch) const {
+	unsigned widest = m_numInputs;
+	for (unsigned layerNum = 0; layerNum < m_layers.size(); ++layerNum) widest = max(widest, m_layers[layerNum].numNeurons);
+	if (scratch.activations.size() < uint64_t(numRows) * widest) {
+		scratch.activations.resize(uint64_t(numRows) * widest);
+		scratch.quantized.resize(uint64_t(numRows) * widest);
+	}
+	if (scratch.rowScales.size() < numRows) scratch.rowScales.resize(numRows);
+	float *activations = scratch.activations.data();
+	for (unsigned r = 0; r < numRows; ++r) {
+		copy(inputs + uint64_t(r) * inputStride, inputs + uint64_t(r) * inputStride + m_numInputs, activations + uint64_t(r) * m_numInputs);
+	}
+	for (unsigned layerNum = 0; layerNum < m_layers.size(); ++layerNum) {
+		const QuantizedLayer &layer = m_layers[layerNum];
+		for (unsigned r = 0; r < numRows; ++r) {      // every activation is read, so the layer can overwrite them below
+			quantizeRow(activations + uint64_t(r) * layer.numInputs, layer.numInputs,
+				&scratch.quantized[uint64_t(r) * layer.numInputs], scratch.rowScales[r]);
+		}
+		for (unsigned r0 = 0; r0 < numRows; r0 += ROW_BLOCK) {
+			unsigned r1 = min(numRows, r0 + ROW_BLOCK);
+			for (unsigned n = 0; n < layer.numNeurons; ++n) {
+				const int8_t *w = &layer.weights[uint64_t(n) * layer.numInputs];
+				for (unsigned r = r0; r < r1; ++r) {
+					int32_t sum = Kernels::dot(&scratch.quantized[uint64_t(r) * layer.numInputs], w, layer.numInputs);
+					activations[uint64_t(r) * layer.numNeurons + n] = float(sum) * (layer.scale * scratch.rowScales[r]) + layer.biases[n];
+				}
+			}
+		}
+		Activation::apply(layer.activation, activations, numRows * layer.numNeurons);
+	}
+	unsigned numOutputs = getNumOutputs();
+	copy(activations, activations + uint64_t(numRows) * numOutputs, outputs);
+}
+
+uint64_t QuantizedNet::weightBytes(void) const {
+	uint64_t bytes = 0;
+	for (unsigned layerNum = 0; layerNum < m_layers.size(); ++layerNum) {
+		bytes += m_layers[layerNum].weights.size() + m_layers[layerNum].biases.size() * sizeof(float) + sizeof(float);
+	}
+	return bytes;
+}
+
+/* the error of both models against the targets, how far their outputs drift apart, how often they land on the
+   same side of 0.5 (the 0/1 targets of the training files) and how fast each one runs. */
+template <typename T>
+void QuantizedNet::accuracyReport(const BasicNet<T> &net, const double *samples, unsigned numSamples, ostream &out) {
+	QuantizedNet quantized(net);
+	unsigned numInputs = net.getNumInputs(), numOutputs = net.getNumOutputs(), stride = numInputs + numOutputs;
+	vector<double> netOutputs(uint64_t(numSamples) * numOutputs), quantizedOutputs(netOutputs.size());
+	typename BasicNet<T>::Scratch netScratch;
+	Scratch quantizedScratch;
+	const unsigned batchSize = 256;
+	double netSeconds = 0.0, quantizedSeconds = 0.0;
+	for (unsigned start = 0; start < numSamples; start += batchSize) {
+		unsigned count = min(batchSize, numSamples - start);
+		chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+		net.inferBatch(samples + uint64_t(start) * stride, stride, count, &netOutputs[uint64_t(start) * numOutputs], netScratch);
+		chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+		quantized.inferBatch(samples + uint64_t(start) * stride, stride, count, &quantizedOutputs[uint64_t(start) * numOutputs], quantizedScratch);
+		netSeconds += chrono::duration<double>(middle - begin).count();
+		quantizedSeconds += chrono::duration<double>(chrono::steady_clock::now() - middle).count();
+	}
+	double netError = 0.0, quantizedError = 0.0, largestDelta = 0.0, totalDelta = 0.0;
+	uint64_t agreements = 0;
+	for (unsigned r = 0; r < numSamples; ++r) {
+		const double *targets = samples + uint64_t(r) * stride + numInputs;
+		double netSquares = 0.0, quantizedSquares = 0.0;
+		for (unsigned n = 0; n < numOutputs; ++n) {
+			double a = netOutputs[uint64_t(r) * numOutputs + n], b = quantizedOutputs[uint64_t(r) * numOutputs + n];
+			netSquares += (targets[n] - a) * (targets[n] - a);
+			quantizedSquares += (targets[n] - b) * (targets[n] - b);
+			largestDelta = max(largestDelta, fabs(a - b));
+			totalDelta += fabs(a - b);
+			agreements += (a >= 0.5) == (b >= 0.5);
+		}
+		netError += sqrt(netSquares / numOutputs);
+		quantizedError += sqrt(quantizedSquares / numOutputs);
+	}
+	uint64_t numValues = max<uint64_t>(1, uint64_t(numSamples) * numOutputs);
+	uint64_t netBytes = 0;
+	for (unsigned layerNum = 1; layerNum < net.getNumLayers(); ++layerNum) netBytes += uint64_t(net.getLayer(layerNum).numWeights()) * sizeof(T);
+	out << "int8 quantization over " << numSamples << " samples (" << (sizeof(T) == sizeof(double) ? "double" : "float") << " model vs int8 model)\n"
+		<< "  mean RMS error:        " << netError / max(1u, numSamples) << " vs " << quantizedError / max(1u, numSamples) << "\n"
+		<< "  output delta:          mean " << totalDelta / numValues << ", max " << largestDelta << "\n"
+		<< "  same side of 0.5:      " << 100.0 * agreements / numValues << "% of outputs\n"
+		<< "  weights:               " << netBytes << " bytes vs " << quantized.weightBytes() << " bytes\n"
+		<< "  rows/sec (batch " << batchSize << "):  " << fixed << setprecision(0) << numSamples / max(netSeconds, 1e-9)
+		<< " vs " << numSamples / max(quantizedSeconds, 1e-9) << "\n";
+	out.unsetf(ios::fixed);
+	out << setprecision(6);
+}
+
+template QuantizedNet::QuantizedNet(const BasicNet<double> &net);
+template QuantizedNet::QuantizedNet(const BasicNet<float> &net);
+template void QuantizedNet::accuracyReport(const BasicNet<double> &net, const double *samples, unsigned numSamples, ostream &out);
+template void QuantizedNet::accuracyReport(const BasicNet<float> &net, const double *samples, unsigned numSamples, ostream &out);
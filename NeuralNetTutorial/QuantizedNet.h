@@ -0,0 +1,40 @@
+#pragma once
+#ifndef QuantizedNet_H
+#define QuantizedNet_H
+#include "Net.h"
+
+/* an inference only copy of a trained net with int8 weights. every layer keeps one scale for its weights
+   (the largest weight maps to 127) and its bias weights in float. the activations feeding a layer are quantized
+   per sample the same way, so the dot products run on int8 values with exact int32 sums, and one multiply by
+   the two scales turns each sum back into a float before the bias and the layer's activation are applied. */
+class QuantizedNet {
+public:
+	struct Scratch {
+		vector<float> activations;  // the current layer's float outputs, one row per sample
+		vector<int8_t> quantized;   // the same values as int8
+		vector<float> rowScales;    // the scale each row was quantized with
+	};
+	template <typename T>
+	explicit QuantizedNet(const BasicNet<T> &net);
+	void inferBatch(const double *inputs, unsigned inputStride, unsigned numRows, double *outputs, Scratch &scratch) const;
+	unsigned getNumInputs(void) const { return m_numInputs; }
+	unsigned getNumOutputs(void) const { return m_layers.back().numNeurons; }
+	uint64_t weightBytes(void) const;   // the int8 weights, bias weights and scales together
+	uint64_t getWeightVersion(void) const { return m_weightVersion; }   // a new one, its outputs aren't the net's
+	/* runs the samples (trainBatch rows) through net and its quantized copy and prints how far apart they are */
+	template <typename T>
+	static void accuracyReport(const BasicNet<T> &net, const double *samples, unsigned numSamples, ostream &out);
+private:
+	struct QuantizedLayer {
+		unsigned numNeurons, numInputs;   // numInputs doesn't count the bias neuron
+		float scale;                      // weight = int8 value * scale
+		Activation::Kind activation;
+		vector<int8_t> weights;           // numNeurons rows of numInputs
+		vector<float> biases;             // the weight from the bias neuron into every neuron
+	};
+	static void quantizeRow(const float *values, unsigned count, int8_t *quantized, float &scale);
+	unsigned m_numInputs;
+	vector<QuantizedLayer> m_layers;      // every layer after the input layer
+	uint64_t m_weightVersion;
+};
+#endif // !QuantizedNet_H
@@ -0,0 +1,140 @@
+#include "SparseNet.h"
+#include "Kernels.h"
+#include <limits>
+
+template <typename T>
+BasicSparseNet<T>::BasicSparseNet(const BasicNet<T> &net) : m_numInputs(net.getNumInputs()), m_weightVersion(net.getWeightVersion()) {
+	for (unsigned layerNum = 1; layerNum < net.getNumLayers(); ++layerNum) {
+		const BasicLayer<T> &source = net.getLayer(layerNum);
+		SparseLayer layer;
+		layer.numNeurons = source.size();
+		layer.numInputs = source.numInputs();
+		layer.activation = source.getActivation();
+		layer.rowStarts.push_back(0);
+		for (unsigned n = 0; n < layer.numNeurons; ++n) {
+			for (unsigned i = 0; i < layer.numInputs; ++i) {
+				T weight = source.getWeight(n, i);
+				if (weight == T(0)) continue;
+				layer.values.push_back(weight);
+				layer.columns.push_back(i);
+			}
+			layer.rowStarts.push_back(uint32_t(layer.values.size()));
+		}
+		m_layers.push_back(layer);
+	}
+}
+
+/* the batch goes in transposed, input i of every sample in row i, and every layer leaves its outputs the same way,
+   followed by a row of ones for the bias. scratch.inputs and scratch.outputs swap roles from layer to layer. */
+template <typename T>
+void BasicSparseNet<T>::inferBatch(const double *inputs, unsigned inputStride, unsigned numRows, double *outputs, Scratch &scratch) const {
+	unsigned widest = m_numInputs + 1;
+	for (unsigned layerNum = 0; layerNum < m_layers.size(); ++layerNum) widest = max(widest, m_layers[layerNum].numNeurons + 1);
+	if (scratch.inputs.size() < uint64_t(numRows) * widest) {
+		scratch.inputs.resize(uint64_t(numRows) * widest);
+		scratch.outputs.resize(uint64_t(numRows) * widest);
+	}
+	T *in = scratch.inputs.data(), *out = scratch.outputs.data();
+	for (unsigned r = 0; r < numRows; ++r) {
+		for (unsigned i = 0; i < m_numInputs; ++i) in[uint64_t(i) * numRows + r] = T(inputs[uint64_t(r) * inputStride + i]);
+	}
+	fill(in + uint64_t(m_numInputs) * numRows, in + uint64_t(m_numInputs + 1) * numRows, T(1));
+	for (unsigned layerNum = 0; layerNum < m_layers.size(); ++layerNum) {
+		const SparseLayer &layer = m_layers[layerNum];
+		fill(out, out + uint64_t(layer.numNeurons) * numRows, T(0));
+		for (unsigned n = 0; n < layer.numNeurons; ++n) {
+			T *sums = out + uint64_t(n) * numRows;
+			for (uint32_t k = layer.rowStarts[n]; k < layer.rowStarts[n + 1]; ++k) {
+				Kernels::axpy(sums, in + uint64_t(layer.columns[k]) * numRows, layer.values[k], numRows);
+			}
+		}
+		Activation::apply(layer.activation, out, layer.numNeurons * numRows);
+		fill(out + uint64_t(layer.numNeurons) * numRows, out + uint64_t(layer.numNeurons + 1) * numRows, T(1));
+		swap(in, out);
+	}
+	unsigned numOutputs = getNumOutputs();
+	for (unsigned r = 0; r < numRows; ++r) {
+		for (unsigned n = 0; n < numOutputs; ++n) outputs[uint64_t(r) * numOutputs + n] = double(in[uint64_t(n) * numRows + r]);
+	}
+}
+
+template <typename T>
+uint64_t BasicSparseNet<T>::weightBytes(void) const {
+	uint64_t bytes = 0;
+	for (unsigned layerNum = 0; layerNum < m_layers.size(); ++layerNum) {
+		const SparseLayer &layer = m_layers[layerNum];
+		bytes += layer.values.size() * sizeof(T) + (layer.columns.size() + layer.rowStarts.size()) * sizeof(uint32_t);
+	}
+	return bytes;
+}
+
+template <typename T>
+uint64_t BasicSparseNet<T>::numWeights(void) const {
+	uint64_t count = 0;
+	for (unsigned layerNum = 0; layerNum < m_layers.size(); ++layerNum) count += m_layers[layerNum].values.size();
+	return count;
+}
+
+/* runs model over the inputs of the samples in batches of batchSize, three times, and returns the fastest pass. */
+template <class Model>
+static double timeInference(const Model &model, const double *samples, unsigned numSamples, unsigned stride, unsigned batchSize,
+	double *outputs, typename Model::Scratch &scratch) {
+	double fastest = numeric_limits<double>::infinity();
+	for (unsigned pass = 0; pass < 3; ++pass) {
+		chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+		for (unsigned start = 0; start < numSamples; start += batchSize) {
+			unsigned count = min(batchSize, numSamples - start);
+			model.inferBatch(samples + uint64_t(start) * stride, stride, count, outputs + uint64_t(start) * model.getNumOutputs(), scratch);
+		}
+		fastest = min(fastest, chrono::duration<double>(chrono::steady_clock::now() - begin).count());
+	}
+	return fastest;
+}
+
+/* the dense column is the pruned net itself (zeros and all), so the speedup is what the sparse layout adds on top of
+   pruning. the error is the mean RMS error against the targets, the drift how far the outputs moved from the
+   unpruned net's, largest first. */
+template <typename T>
+void BasicSparseNet<T>::pruningReport(const BasicNet<T> &net, const double *samples, unsigned numSamples, const vector<double> &sparsities, ostream &out) {
+	unsigned numInputs = net.getNumInputs(), numOutputs = net.getNumOutputs(), stride = numInputs + numOutputs;
+	const unsigned batchSize = 256;
+	vector<double> original(uint64_t(numSamples) * numOutputs), dense(original.size()), sparse(original.size());
+	typename BasicNet<T>::Scratch netScratch;
+	Scratch sparseScratch;
+	timeInference(net, samples, numSamples, stride, batchSize, original.data(), netScratch);
+	out << "pruning over " << numSamples << " samples (" << (sizeof(T) == sizeof(double) ? "double" : "float") << " weights, batch of "
+		<< batchSize << ", dense vs sparse)\n" << left << setw(10) << "sparsity" << setw(10) << "weights" << setw(22) << "bytes"
+		<< setw(26) << "rows/sec" << setw(10) << "speedup" << setw(14) << "RMS error" << "drift\n";
+	for (unsigned s = 0; s < sparsities.size(); ++s) {
+		BasicNet<T> pruned(net);
+		pruned.pruneToSparsity(sparsities[s]);
+		BasicSparseNet sparseNet(pruned);
+		double denseSeconds = timeInference(pruned, samples, numSamples, stride, batchSize, dense.data(), netScratch);
+		double sparseSeconds = timeInference(sparseNet, samples, numSamples, stride, batchSize, sparse.data(), sparseScratch);
+		uint64_t denseBytes = 0;
+		for (unsigned layerNum = 1; layerNum < pruned.getNumLayers(); ++layerNum) denseBytes += uint64_t(pruned.getLayer(layerNum).numWeights()) * sizeof(T);
+		double error = 0.0, drift = 0.0;
+		for (unsigned r = 0; r < numSamples; ++r) {
+			const double *targets = samples + uint64_t(r) * stride + numInputs;
+			double squares = 0.0;
+			for (unsigned n = 0; n < numOutputs; ++n) {
+				double value = sparse[uint64_t(r) * numOutputs + n];
+				squares += (targets[n] - value) * (targets[n] - value);
+				drift = max(drift, fabs(value - original[uint64_t(r) * numOutputs + n]));
+			}
+			error += sqrt(squares / numOutputs);
+		}
+		stringstream sparsity, bytes, rates;
+		sparsity << fixed << setprecision(1) << 100.0 * pruned.getSparsity() << "%";
+		bytes << denseBytes << " vs " << sparseNet.weightBytes();
+		rates << fixed << setprecision(0) << numSamples / max(denseSeconds, 1e-9) << " vs " << numSamples / max(sparseSeconds, 1e-9);
+		out << setw(10) << sparsity.str() << setw(10) << sparseNet.numWeights() << setw(22) << bytes.str() << setw(26) << rates.str()
+			<< fixed << setprecision(2) << setw(10) << denseSeconds / max(sparseSeconds, 1e-9) << setprecision(6) << setw(14)
+			<< error / max(1u, numSamples) << drift << "\n";
+		out.unsetf(ios::fixed);
+	}
+	out << right << setprecision(6);
+}
+
+template class BasicSparseNet<double>;
+template class BasicSparseNet<float>;
@@ -0,0 +1,40 @@
+#pragma once
+#ifndef SparseNet_H
+#define SparseNet_H
+#include "Net.h"
+
+/* an inference only copy of a pruned net that keeps nothing but the weights that are left, as compressed sparse
+   rows: per layer the nonzero weights row by row, the input each one reads and where every neuron's row starts.
+   a forward pass costs one multiply-add per kept weight instead of one per weight. a batch is held transposed, one
+   row per neuron holding that neuron's value for every sample, so each kept weight is a single vectorized axpy
+   over the batch (Kernels::axpy): the sums of every neuron are built in the order of its row, like a dot product. */
+template <typename T>
+class BasicSparseNet {
+public:
+	struct Scratch {
+		vector<T> inputs, outputs;   // a layer's rows of samples, the bias row included, and the next layer's
+	};
+	explicit BasicSparseNet(const BasicNet<T> &net);   // every weight of net that isn't zero, pruned or not
+	void inferBatch(const double *inputs, unsigned inputStride, unsigned numRows, double *outputs, Scratch &scratch) const;
+	unsigned getNumInputs(void) const { return m_numInputs; }
+	unsigned getNumOutputs(void) const { return m_layers.back().numNeurons; }
+	uint64_t getWeightVersion(void) const { return m_weightVersion; }   // the net's, the outputs are the same up to rounding
+	uint64_t weightBytes(void) const;    // values, columns and row starts together
+	uint64_t numWeights(void) const;     // the kept ones
+	/* prunes copies of net to each sparsity in turn and prints what the sparse copy of each saves against running
+	   the pruned net dense: weight memory, rows/sec and how far the outputs moved from the unpruned net's */
+	static void pruningReport(const BasicNet<T> &net, const double *samples, unsigned numSamples, const vector<double> &sparsities, ostream &out);
+private:
+	struct SparseLayer {
+		unsigned numNeurons, numInputs;   // numInputs counts the previous layer's bias neuron
+		Activation::Kind activation;
+		vector<T> values;                 // the kept weights, row by row
+		vector<uint32_t> columns;         // the input each one reads
+		vector<uint32_t> rowStarts;       // numNeurons + 1, row n is [rowStarts[n], rowStarts[n + 1])
+	};
+	unsigned m_numInputs;
+	vector<SparseLayer> m_layers;         // every layer after the input layer
+	uint64_t m_weightVersion;
+};
+typedef BasicSparseNet<double> SparseNet;
+#endif // !SparseNet_H
@@ -0,0 +1,190 @@
+#pragma once
+#ifndef StaticNet_H
+#define StaticNet_H
+#include "Checkpoint.h"
+#include "Activation.h"
+#include <array>
+
+/* the parts of StaticNet that don't depend on its sizes: the same training rate, momentum and error smoothing as
+   Layer and Net, fixed at compile time. */
+class StaticNetBase {
+public:
+	static constexpr double eta = 0.33;
+	static constexpr double alpha = 0.55;
+	static constexpr double recentAverageSmoothingFactor = 100.0;
+};
+
+/* the layers of a StaticNet after its input layer, as a chain. each link holds a layer of NumNeurons neurons fed by
+   the NumInputs neurons before it (laid out like BasicLayer: row n holds the weights into neuron n, bias weight
+   last) and the links of the layers after it. every trip count below is a constant, so the compiler can unroll
+   the loops and keep the whole chain inline. the sums run in the same order as the scalar kernels, so with
+   NN_SIMD=scalar a StaticNet and a Net holding the same weights produce exactly the same numbers. every layer
+   runs the activation Policy (see Activation.h). */
+template <class Policy, unsigned NumInputs, unsigned... Sizes>
+struct StaticLayers {                      // the end of the chain, past the output layer
+	void randomize(void) {}
+	void feedForward(const double *) {}
+	const double *results(const double *outputVals) const { return outputVals; }
+	void calcGradients(const double *) {}
+	template <class Link>
+	void calcGradientsOf(Link &outputLayer, const double *targetVals) const {
+		for (unsigned n = 0; n < NumInputs; ++n) {
+			double delta = targetVals[n] - outputLayer.outputVals[n];
+			outputLayer.gradients[n] = delta * Policy::derivative(outputLayer.outputVals[n]);
+		}
+	}
+	void updateWeights(const double *) {}
+	void collect(vector<const double *> &) const {}
+	void load(const double *) {}
+};
+
+template <class Policy, unsigned NumInputs, unsigned NumNeurons, unsigned... Rest>
+struct StaticLayers<Policy, NumInputs, NumNeurons, Rest...> {
+	static const unsigned stride = NumInputs + 1;   // the previous layer's neurons plus its bias
+	static const unsigned numWeights = NumNeurons * stride;
+	array<double, numWeights> weights;
+	array<double, numWeights> deltaWeights;         // last change of each weight (momentum)
+	array<double, NumNeurons + 1> outputVals;       // the bias neuron's 1.0 last
+	array<double, NumNeurons + 1> gradients;
+	StaticLayers<Policy, NumNeurons, Rest...> next;
+
+	/* draws the weights in the same order as BasicLayer, so the same seed gives the same starting net. */
+	void randomize(void) {
+		for (unsigned i = 0; i < stride; ++i) {
+			for (unsigned n = 0; n < NumNeurons; ++n) weights[n * stride + i] = rand() / double(RAND_MAX);
+		}
+		deltaWeights.fill(0.0);
+		outputVals.fill(0.0);
+		outputVals[NumNeurons] = 1.0;
+		gradients.fill(0.0);
+		next.randomize();
+	}
+	void feedForward(const double *inputVals) {
+		for (unsigned n = 0; n < NumNeurons; ++n) {
+			double sum = 0.0;
+			for (unsigned i = 0; i < stride; ++i) sum += inputVals[i] * weights[n * stride + i];
+			outputVals[n] = Policy::value(sum);
+		}
+		next.feedForward(outputVals.data());
+	}
+	const double *results(const double *) const { return next.results(outputVals.data()); }
+	/* the output layer's gradients first, then every hidden layer's from the one after it. */
+	void calcGradients(const double *targetVals) {
+		next.calcGradients(targetVals);
+		next.calcGradientsOf(*this, targetVals);
+	}
+	template <class Link>
+	void calcGradientsOf(Link &prevLayer, const double *) const {
+		for (unsigned i = 0; i < NumInputs; ++i) prevLayer.gradients[i] = 0.0;
+		for (unsigned n = 0; n < NumNeurons; ++n) {
+			for (unsigned i = 0; i < NumInputs; ++i) prevLayer.gradients[i] += weights[n * stride + i] * gradients[n];
+		}
+		for (unsigned i = 0; i < NumInputs; ++i) {
+			prevLayer.gradients[i] = prevLayer.gradients[i] * Policy::derivative(prevLayer.outputVals[i]);
+		}
+	}
+	void updateWeights(const double *inputVals) {
+		for (unsigned n = 0; n < NumNeurons; ++n) {
+			for (unsigned i = 0; i < stride; ++i) {
+				double &dw = deltaWeights[n * stride + i];
+				dw = StaticNetBase::eta * inputVals[i] * gradients[n] + StaticNetBase::alpha * dw;
+				weights[n * stride + i] += dw;
+			}
+		}
+		next.updateWeights(outputVals.data());
+	}
+	void collect(vector<const double *> &arrays) const {   // checkpoint order: weights, then delta weights
+		arrays.push_back(weights.data());
+		arrays.push_back(deltaWeights.data());
+		next.collect(arrays);
+	}
+	void load(const double *values) {
+		copy(values, values + numWeights, weights.begin());
+		copy(values + numWeights, values + 2 * numWeights, deltaWeights.begin());
+		next.load(values + 2 * numWeights);
+	}
+};
+
+/* a network whose topology is fixed at compile time, StaticNet<3, 4, 3, 2> is the 3-4-3-2 net of learnData.txt.
+   it trains and answers exactly like Net, one sample at a time, but every array has its size in its type: the
+   whole net is one object (on the stack if it's declared there), nothing is allocated and the small loops are
+   unrolled. its activation is fixed at compile time too, BasicStaticNet<ReluActivation, 3, 4, 3, 2> is the same
+   net with relu neurons. it reads and writes the same checkpoints as Net, as long as they hold its activation. */
+template <class Policy, unsigned NumInputs, unsigned... Sizes>
+class BasicStaticNet : public StaticNetBase {
+	static_assert(sizeof...(Sizes) >= 1, "a net needs at least an input and an output layer");
+public:
+	BasicStaticNet() : m_error(0.0), m_recentAverageError(0.0) {
+		m_inputVals.fill(0.0);
+		m_inputVals[NumInputs] = 1.0;
+		m_layers.randomize();
+	}
+	void feedForward(const vector<double> &inputVals) {
+		assert(inputVals.size() == NumInputs);
+		feedForward(inputVals.data());
+	}
+	void feedForward(const double *inputVals) {
+		copy(inputVals, inputVals + NumInputs, m_inputVals.begin());
+		m_layers.feedForward(m_inputVals.data());
+	}
+	void backProp(const vector<double> &targetVals) { backProp(targetVals.data()); }
+	void backProp(const double *targetVals) {
+		const double *outputVals = getOutputs();
+		m_error = 0.0;
+		for (unsigned n = 0; n < getNumOutputs(); ++n) {
+			double delta = targetVals[n] - outputVals[n];
+			m_error += delta * delta;
+		}
+		m_error = sqrt(m_error / getNumOutputs());   // RMS
+		m_recentAverageError = (m_recentAverageError * recentAverageSmoothingFactor + m_error) / (recentAverageSmoothingFactor + 1.0);
+		m_layers.calcGradients(targetVals);
+		m_layers.updateWeights(m_inputVals.data());
+	}
+	void getResults(vector<double> &resultVals) const {
+		resultVals.assign(getOutputs(), getOutputs() + getNumOutputs());
+	}
+	const double *getOutputs(void) const { return m_layers.results(m_inputVals.data()); } // getNumOutputs() values
+	double getRecentAverageError(void) const { return m_recentAverageError; }
+	static constexpr unsigned getNumInputs(void) { return NumInputs; }
+	static constexpr unsigned getNumOutputs(void) {
+		const unsigned sizes[] = { Sizes... };
+		return sizes[sizeof...(Sizes) - 1];
+	}
+	static vector<unsigned> getTopology(void) { return { NumInputs, Sizes... }; }
+	void writeNet(const string &fileName) const {   // throws runtime_error
+		vector<const double *> arrays;
+		m_layers.collect(arrays);
+		vector<uint32_t> activations(sizeof...(Sizes), ActivationKind<Policy>::kind);
+		CheckpointSection section = { "ACTV", reinterpret_cast<const char *>(activations.data()), activations.size() * sizeof(uint32_t) };
+		writeCheckpoint(fileName, getTopology(), arrays, vector<CheckpointSection>(1, section));
+	}
+	/* only binary checkpoints, the text format is left to Net. throws runtime_error and leaves the net as it was
+	   if the file can't be used, which includes a net saved with other activations. the optimizer state is
+	   ignored, StaticNet always trains with momentum. */
+	void readNet(const string &fileName) {
+		MappedFile file;
+		vector<CheckpointSection> sections;
+		const double *weights = mapCheckpoint(file, fileName, getTopology(), &sections);
+		if (weights == NULL) throw runtime_error(fileName + " isn't a checkpoint");
+		vector<Activation::Kind> activations(sizeof...(Sizes), Activation::TANH);
+		const CheckpointSection *section = findSection(sections, "ACTV");
+		if (section && !Activation::readSection(section->data, section->bytes, sizeof...(Sizes), activations)) {
+			throw runtime_error(fileName + " has a damaged activation section");
+		}
+		for (unsigned l = 0; l < activations.size(); ++l) {
+			if (activations[l] != ActivationKind<Policy>::kind) {
+				throw runtime_error(fileName + " holds a net with " + Activation::name(activations[l]) + " neurons, this one has "
+					+ Activation::name(ActivationKind<Policy>::kind) + " neurons");
+			}
+		}
+		m_layers.load(weights);
+	}
+private:
+	array<double, NumInputs + 1> m_inputVals;   // the input layer's outputs, bias included
+	StaticLayers<Policy, NumInputs, Sizes...> m_layers;
+	double m_error;
+	double m_recentAverageError;
+};
+template <unsigned NumInputs, unsigned... Sizes>
+using StaticNet = BasicStaticNet<TanhActivation, NumInputs, Sizes...>;
+#endif // !StaticNet_H
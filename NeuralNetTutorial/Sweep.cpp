@@ -0,0 +1,79 @@
+#include "Sweep.h"
+
+vector<SweepBase::Config> SweepBase::grid(const vector<vector<unsigned> > &topologies, const vector<NetConfig::Optimizer> &optimizers,
+	const vector<double> &etas, const vector<double> &alphas, const NetConfig &base, const vector<uint32_t> &seeds) {
+	vector<Config> configs;
+	for (unsigned t = 0; t < topologies.size(); ++t) {
+		for (unsigned o = 0; o < optimizers.size(); ++o) {
+			vector<double> optimizerEtas = etas.empty() ? vector<double>(1, NetConfig::defaultEta(optimizers[o])) : etas;
+			for (unsigned e = 0; e < optimizerEtas.size(); ++e) {
+				for (unsigned a = 0; a < alphas.size(); ++a) {
+					for (unsigned s = 0; s < seeds.size(); ++s) {
+						Config config = { topologies[t], base, seeds[s] };
+						config.net.optimizer = optimizers[o];
+						config.net.eta = optimizerEtas[e];
+						config.net.alpha = alphas[a];
+						configs.push_back(config);
+					}
+				}
+			}
+		}
+	}
+	return configs;
+}
+
+static bool lowerError(const SweepBase::Result &a, const SweepBase::Result &b) {
+	if (a.report.bestError != b.report.bestError) return a.report.bestError < b.report.bestError;
+	return a.report.seconds < b.report.seconds;
+}
+
+void SweepBase::printRanking(vector<Result> results, bool target, ostream &out) {
+	stable_sort(results.begin(), results.end(), lowerError);
+	out << left << setw(6) << "rank" << setw(16) << "topology" << setw(10) << "optimizer" << setw(8) << "eta" << setw(8) << "alpha" << setw(8) << "seed"
+		<< setw(8) << "epochs" << setw(14) << "error" << setw(12) << "secs";
+	if (target) out << "secs to target";
+	out << "\n";
+	for (unsigned r = 0; r < results.size(); ++r) {
+		const Result &result = results[r];
+		out << setw(6) << r + 1 << setw(16) << topologyString(result.config.topology) << setw(10)
+			<< NetConfig::optimizerName(result.config.net.optimizer) << setw(8) << result.config.net.eta
+			<< setw(8) << result.config.net.alpha << setw(8) << result.config.seed << setw(8) << result.report.epochs
+			<< setw(14) << result.report.bestError << setw(12) << result.report.seconds;
+		if (target) {
+			if (result.report.reachedTarget) out << result.report.targetSeconds;
+			else out << "-";
+		}
+		out << "\n";
+	}
+	out << right;
+}
+
+/* the nets draw their starting weights from rand(), which every thread shares: a net is built under a lock right
+   after srand(seed), so its weights don't depend on which thread built it or when. */
+template <typename T>
+vector<SweepBase::Result> BasicSweep<T>::run(const vector<Config> &configs, const double *samples, uint64_t numSamples,
+	const EpochTrainerBase::Options &options, WorkPool &pool) {
+	vector<Result> results(configs.size());
+	mutex randomLock;
+	pool.run(unsigned(configs.size()), [&](unsigned task, unsigned) {
+		const Config &config = configs[task];
+		unique_ptr<BasicNet<T> > net;
+		{
+			lock_guard<mutex> lock(randomLock);
+			srand(config.seed);
+			net.reset(new BasicNet<T>(config.topology, config.net));
+		}
+		EpochTrainerBase::Options runOptions = options;
+		runOptions.seed = config.seed;
+		runOptions.numThreads = 1;                 // the pool's threads are the parallelism
+		runOptions.mode = ParallelTrainerBase::SYNC;
+		BasicEpochTrainer<T> trainer(*net, samples, numSamples, runOptions);
+		vector<double> inputVals, targetVals, resultVals;
+		results[task].config = config;
+		results[task].report = trainer.train(NULL, NULL, inputVals, targetVals, resultVals);
+	});
+	return results;
+}
+
+template class BasicSweep<double>;
+template class BasicSweep<float>;
@@ -0,0 +1,35 @@
+#pragma once
+#ifndef Sweep_H
+#define Sweep_H
+#include "EpochTrainer.h"
+#include "WorkPool.h"
+
+/* trains one fresh net per combination of topology, optimizer, training rate, momentum and seed, several at once on a
+   WorkPool, and ranks them by the error they ended with. every net reads the same samples (the in-memory dataset,
+   never copied) and trains on one thread with the same EpochTrainer options, so a run is only a function of its
+   configuration: the seed picks both its starting weights and its shuffles. */
+class SweepBase {
+public:
+	struct Config {
+		vector<unsigned> topology;
+		NetConfig net;
+		uint32_t seed;
+	};
+	struct Result {
+		Config config;
+		EpochTrainerBase::Report report;   // bestError is the error the run is ranked by
+	};
+	// every combination, topologies outermost and seeds innermost. base gives the other settings, an empty etas
+	// trains each optimizer at its NetConfig::defaultEta
+	static vector<Config> grid(const vector<vector<unsigned> > &topologies, const vector<NetConfig::Optimizer> &optimizers,
+		const vector<double> &etas, const vector<double> &alphas, const NetConfig &base, const vector<uint32_t> &seeds);
+	static void printRanking(vector<Result> results, bool target, ostream &out); // lowest error first, the faster run on a tie
+};
+
+template <typename T>
+class BasicSweep : public SweepBase {
+public:
+	static vector<Result> run(const vector<Config> &configs, const double *samples, uint64_t numSamples,
+		const EpochTrainerBase::Options &options, WorkPool &pool);
+};
+#endif // !Sweep_H
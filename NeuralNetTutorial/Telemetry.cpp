@@ -0,0 +1,156 @@
+#include "Telemetry.h"
+
+static const char *PHASE_NAMES[TrainingCounters::NUM_PHASES] = { "parse", "forward", "backward", "update" };
+
+/* one line per snapshot: CSV with a header naming the columns, or a JSON object. every line is flushed as it is
+   written, so the file can be watched while the net trains. */
+class Telemetry::FileSink : public Telemetry::Sink {
+public:
+	FileSink(const string &fileName, bool json) : m_out(fileName.c_str()), m_json(json), m_wroteHeader(false) {
+		m_out << setprecision(9);
+	}
+	bool isOpen(void) const { return m_out.is_open(); }
+	void write(const Snapshot &snapshot) {
+		if (m_json) writeJson(snapshot);
+		else writeCsv(snapshot);
+		m_out.flush();
+	}
+private:
+	void writeCsv(const Snapshot &snapshot) {
+		if (!m_wroteHeader) {
+			m_out << "seconds,samples,samples_per_sec,rms_error,recent_average_error";
+			for (unsigned p = 0; p < TrainingCounters::NUM_PHASES; ++p) m_out << "," << PHASE_NAMES[p] << "_seconds";
+			for (unsigned l = 0; l < snapshot.gradientNorms.size(); ++l) m_out << ",gradient_norm_" << l + 1;
+			m_out << "\n";
+			m_wroteHeader = true;
+		}
+		m_out << snapshot.seconds << "," << snapshot.samples << "," << snapshot.samplesPerSecond << "," << snapshot.rmsError
+			<< "," << snapshot.recentAverageError;
+		for (unsigned p = 0; p < TrainingCounters::NUM_PHASES; ++p) m_out << "," << snapshot.phaseSeconds[p];
+		for (unsigned l = 0; l < snapshot.gradientNorms.size(); ++l) m_out << "," << snapshot.gradientNorms[l];
+		m_out << "\n";
+	}
+	void writeJson(const Snapshot &snapshot) {
+		m_out << "{\"seconds\": " << snapshot.seconds << ", \"samples\": " << snapshot.samples << ", \"samples_per_sec\": "
+			<< snapshot.samplesPerSecond << ", \"rms_error\": " << snapshot.rmsError << ", \"recent_average_error\": "
+			<< snapshot.recentAverageError << ", \"phase_seconds\": {";
+		for (unsigned p = 0; p < TrainingCounters::NUM_PHASES; ++p) {
+			m_out << (p > 0 ? ", \"" : "\"") << PHASE_NAMES[p] << "\": " << snapshot.phaseSeconds[p];
+		}
+		m_out << "}, \"gradient_norms\": [";
+		for (unsigned l = 0; l < snapshot.gradientNorms.size(); ++l) m_out << (l > 0 ? ", " : "") << snapshot.gradientNorms[l];
+		m_out << "]}\n";
+	}
+	ofstream m_out;
+	bool m_json;
+	bool m_wroteHeader;
+};
+
+static void showValues(ostream &out, const string &label, const vector<double> &values) {
+	out << label << " ";
+	for (unsigned i = 0; i < values.size(); ++i) out << values[i] << " ";
+	out << endl;
+}
+
+void Telemetry::ConsoleSink::write(const Snapshot &snapshot) {
+	if (snapshot.final) return;
+	m_out << endl << "Pass " << snapshot.samples;
+	showValues(m_out, ": Inputs:", snapshot.inputVals);
+	showValues(m_out, "Outputs:", snapshot.resultVals);
+	showValues(m_out, "Targets:", snapshot.targetVals);
+	m_out << "Net recent average error: " << snapshot.recentAverageError << endl;
+}
+
+Telemetry::Telemetry(uint64_t every)
+	: m_nextTimedSample(0), m_batchStart(0), m_timedSamples(0), m_every(max<uint64_t>(1, every)), m_nextSnapshot(m_every), m_beginTicks(telemetryTicks()), m_begin(chrono::steady_clock::now()),
+	  m_lastSeconds(0.0), m_lastSamples(0), m_lastErrors(0), m_lastErrorSum(0.0), m_stop(false) {
+	m_counters.wantGradientNorms = true;         // the first interval's norms come from its first step
+}
+
+Telemetry::~Telemetry() {
+	finish();
+}
+
+bool Telemetry::openFile(const string &fileName) {
+	bool json = fileName.size() >= 5 && fileName.compare(fileName.size() - 5, 5, ".json") == 0;
+	unique_ptr<FileSink> file(new FileSink(fileName, json));
+	if (!file->isOpen()) return false;
+	m_sinks.push_back(file.get());
+	m_file = move(file);
+	return true;
+}
+
+void Telemetry::addSink(Sink *sink) {
+	m_sinks.push_back(sink);
+}
+
+/* the time stamp counter's rate isn't known up front, so it's measured against the wall clock since construction. */
+double Telemetry::ticksPerSecond(void) const {
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - m_begin).count();
+	uint64_t ticks = telemetryTicks() - m_beginTicks;
+	return seconds > 0.0 && ticks > 0 ? ticks / seconds : 1e9;
+}
+
+double Telemetry::phaseScale(void) const {
+	return m_timedSamples > 0 ? double(m_counters.samples) / m_timedSamples / ticksPerSecond() : 0.0;
+}
+
+double Telemetry::phaseSeconds(TrainingCounters::Phase phase) const {
+	return m_counters.ticks[phase] * phaseScale();
+}
+
+/* only copies numbers on the training thread, everything that formats or writes happens on the writer thread. */
+void Telemetry::snapshot(const vector<double> &inputVals, const vector<double> &resultVals, const vector<double> &targetVals,
+	double recentAverageError, bool final) {
+	if (final && m_counters.samples == m_lastSamples) return;   // the last regular snapshot already has the final numbers
+	Snapshot snapshot;
+	snapshot.seconds = chrono::duration<double>(chrono::steady_clock::now() - m_begin).count();
+	snapshot.samples = m_counters.samples;
+	snapshot.samplesPerSecond = (m_counters.samples - m_lastSamples) / max(snapshot.seconds - m_lastSeconds, 1e-9);
+	snapshot.rmsError = (m_counters.errorSum - m_lastErrorSum) / max<uint64_t>(1, m_counters.errors - m_lastErrors);
+	snapshot.recentAverageError = recentAverageError;
+	double scale = phaseScale();
+	for (unsigned p = 0; p < TrainingCounters::NUM_PHASES; ++p) snapshot.phaseSeconds[p] = m_counters.ticks[p] * scale;
+	snapshot.gradientNorms = m_counters.gradientNorms;
+	snapshot.inputVals = inputVals;
+	snapshot.resultVals = resultVals;
+	snapshot.targetVals = targetVals;
+	snapshot.final = final;
+	m_counters.wantGradientNorms = true;
+	m_lastSeconds = snapshot.seconds;
+	m_lastSamples = m_counters.samples;
+	m_lastErrors = m_counters.errors;
+	m_lastErrorSum = m_counters.errorSum;
+	m_nextSnapshot = (m_counters.samples / m_every + 1) * m_every;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_queue.push_back(snapshot);
+		if (!m_writer.joinable()) m_writer = thread(&Telemetry::writeSnapshots, this);
+	}
+	m_queued.notify_one();
+}
+
+void Telemetry::writeSnapshots(void) {
+	unique_lock<mutex> lock(m_mutex);
+	while (true) {
+		m_queued.wait(lock, [&] { return !m_queue.empty() || m_stop; });
+		if (m_queue.empty()) return;             // stopped and nothing left to write
+		vector<Snapshot> snapshots;
+		snapshots.swap(m_queue);
+		lock.unlock();
+		for (unsigned s = 0; s < snapshots.size(); ++s) {
+			for (unsigned i = 0; i < m_sinks.size(); ++i) m_sinks[i]->write(snapshots[s]);
+		}
+		lock.lock();
+	}
+}
+
+void Telemetry::finish(void) {
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_queued.notify_one();
+	if (m_writer.joinable()) m_writer.join();
+	m_stop = false;
+}
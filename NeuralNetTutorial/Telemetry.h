@@ -0,0 +1,178 @@
+#pragma once
+#ifndef Telemetry_H
+#define Telemetry_H
+#include "Globalfuncs.h"
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+using namespace std;
+
+#ifndef NN_TELEMETRY
+#define NN_TELEMETRY 1     // build with NN_TELEMETRY=0 and every probe below compiles to nothing
+#endif
+
+/* a cheap timestamp for the phase timers: the cpu's time stamp counter where there is one, nanoseconds otherwise.
+   Telemetry works out how many ticks make a second from the wall clock. */
+inline uint64_t telemetryTicks(void) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return uint64_t(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/* what a net collects about its own training while it runs. the net only adds to these plain fields, so every
+   thread that trains gets its own set and they are summed once the threads are done. */
+struct TrainingCounters {
+	enum Phase { PARSE, FORWARD, BACKWARD, UPDATE, NUM_PHASES };
+	uint64_t ticks[NUM_PHASES];    // time spent in each phase, see telemetryTicks
+	uint64_t samples;              // samples trained on
+	uint64_t errors;               // samples whose error was recorded (a lock-free trainer only records some)
+	double errorSum;               // sum of their RMS errors
+	bool timing;                   // the phase timers only run while this is set, see Telemetry::beginBatch
+	bool wantGradientNorms;        // set to ask the next training step to fill gradientNorms
+	vector<double> gradientNorms;  // L2 norm of the error gradient of every layer's weights (mean over the batch)
+	TrainingCounters() { clear(); }
+	void clear(void) {
+		fill(ticks, ticks + NUM_PHASES, 0);
+		samples = errors = 0;
+		errorSum = 0.0;
+		timing = wantGradientNorms = false;
+	}
+	void addTicks(TrainingCounters &other) {   // moves other's phase times into ours
+		for (unsigned p = 0; p < NUM_PHASES; ++p) ticks[p] += other.ticks[p];
+		fill(other.ticks, other.ticks + NUM_PHASES, 0);
+	}
+	/* the probes the nets call. counters may be NULL (no telemetry attached). */
+	static void addSamples(TrainingCounters *counters, unsigned numSamples) {
+#if NN_TELEMETRY
+		if (counters) counters->samples += numSamples;
+#endif
+	}
+	static void recordError(TrainingCounters *counters, double error) {
+#if NN_TELEMETRY
+		if (counters) {
+			++counters->errors;
+			counters->errorSum += error;
+		}
+#endif
+	}
+	static bool wantsGradientNorms(const TrainingCounters *counters) {
+#if NN_TELEMETRY
+		return counters && counters->wantGradientNorms;
+#else
+		return false;
+#endif
+	}
+};
+
+/* times consecutive phases: every mark() charges the time since the previous mark (or construction) to a phase. */
+class PhaseTimer {
+public:
+#if NN_TELEMETRY
+	explicit PhaseTimer(TrainingCounters *counters)
+		: m_counters(counters && counters->timing ? counters : NULL), m_last(m_counters ? telemetryTicks() : 0) {}
+	void mark(TrainingCounters::Phase phase) {
+		if (!m_counters) return;
+		uint64_t now = telemetryTicks();
+		m_counters->ticks[phase] += now - m_last;
+		m_last = now;
+	}
+private:
+	TrainingCounters *m_counters;
+	uint64_t m_last;
+#else
+	explicit PhaseTimer(TrainingCounters *) {}
+	void mark(TrainingCounters::Phase) {}
+#endif
+};
+
+/* turns a net's counters into a stream of snapshots, one every `every` samples. the training loop asks due() after
+   each batch and only then gathers a snapshot, which is queued for a writer thread: the metrics file and the other
+   sinks never make the training thread wait on i/o.
+   reading the clock costs about as much as a small net's forward pass, so the phases aren't timed in every batch:
+   a batch is timed once TIMED_SAMPLE_GAP samples have gone by since the last timed one, and the phase times are
+   scaled up by samples / timed samples. batches of that size or more are all timed and their times are exact. */
+class Telemetry {
+public:
+	struct Snapshot {
+		double seconds;                          // since the telemetry started
+		uint64_t samples;                        // samples trained so far
+		double samplesPerSecond;                 // over the last interval
+		double rmsError;                         // mean sample RMS error over the last interval
+		double recentAverageError;               // the net's smoothed error
+		double phaseSeconds[TrainingCounters::NUM_PHASES]; // so far, summed over worker threads
+		vector<double> gradientNorms;            // one per layer after the input layer
+		vector<double> inputVals, resultVals, targetVals; // the interval's last sample
+		bool final;                              // taken once training is over
+	};
+	class Sink {                                 // receives every snapshot on the writer thread
+	public:
+		virtual ~Sink() {}
+		virtual void write(const Snapshot &snapshot) = 0;
+	};
+	class ConsoleSink : public Sink {            // the pass by pass dump the TRAIN command always printed
+	public:
+		explicit ConsoleSink(ostream &out) : m_out(out) {}
+		void write(const Snapshot &snapshot);
+	private:
+		ostream &m_out;
+	};
+	explicit Telemetry(uint64_t every);
+	~Telemetry();
+	// both before the first snapshot
+	bool openFile(const string &fileName);       // CSV, or JSON (one object per line) if the name ends in .json
+	void addSink(Sink *sink);                    // not owned, must outlive finish()
+	TrainingCounters &counters(void) { return m_counters; }
+	void beginBatch(void) {                      // before the batch is read, decides whether it is timed
+#if NN_TELEMETRY
+		m_counters.timing = m_counters.samples >= m_nextTimedSample;
+		m_batchStart = m_counters.samples;
+#endif
+	}
+	void endBatch(void) {                        // once it is trained on
+#if NN_TELEMETRY
+		if (!m_counters.timing) return;
+		m_timedSamples += m_counters.samples - m_batchStart;
+		m_nextTimedSample = m_counters.samples + TIMED_SAMPLE_GAP;
+#endif
+	}
+	bool due(void) const {
+#if NN_TELEMETRY
+		return m_counters.samples >= m_nextSnapshot;
+#else
+		return false;
+#endif
+	}
+	// the final snapshot (taken once training is over) goes to the metrics file but not to the progress dump
+	void snapshot(const vector<double> &inputVals, const vector<double> &resultVals, const vector<double> &targetVals,
+		double recentAverageError, bool final = false);
+	void finish(void);                           // waits until every queued snapshot is written
+	double phaseSeconds(TrainingCounters::Phase phase) const;
+private:
+	Telemetry(const Telemetry &);
+	Telemetry &operator=(const Telemetry &);
+	class FileSink;
+	void writeSnapshots(void);
+	double ticksPerSecond(void) const;
+	double phaseScale(void) const;               // seconds per tick of the timed batches, scaled to every sample
+	static const unsigned TIMED_SAMPLE_GAP = 16;
+	TrainingCounters m_counters;
+	uint64_t m_nextTimedSample, m_batchStart, m_timedSamples;
+	uint64_t m_every, m_nextSnapshot;
+	uint64_t m_beginTicks;
+	chrono::steady_clock::time_point m_begin;
+	double m_lastSeconds;                        // when the previous snapshot was taken
+	uint64_t m_lastSamples, m_lastErrors;
+	double m_lastErrorSum;
+	unique_ptr<Sink> m_file;
+	vector<Sink *> m_sinks;
+	mutex m_mutex;
+	condition_variable m_queued;
+	vector<Snapshot> m_queue;                    // snapshots waiting for the writer
+	bool m_stop;
+	thread m_writer;                             // started by the first snapshot
+};
+#endif // !Telemetry_H
@@ -0,0 +1,183 @@
+#include "TextSampleReader.h"
+#include <charconv>
+
+/* parses one number at p, false if there isn't one. from_chars doesn't allocate, doesn't look at the locale and
+   doesn't need the text to be null terminated; libraries without the floating point overloads fall back to strtod
+   on a copy of the token kept on the stack. */
+static bool parseDouble(const char *&p, const char *end, double &value) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+	if (p < end && *p == '+') ++p;
+	from_chars_result result = from_chars(p, end, value);
+	if (result.ec != errc()) return false;
+	p = result.ptr;
+	return true;
+#else
+	char token[64];
+	unsigned length = 0;
+	while (p + length < end && length + 1 < sizeof(token) && !isspace((unsigned char)p[length])) {
+		token[length] = p[length];
+		++length;
+	}
+	token[length] = '\0';
+	char *parsedEnd;
+	value = strtod(token, &parsedEnd);
+	if (parsedEnd == token) return false;
+	p += parsedEnd - token;
+	return true;
+#endif
+}
+
+static const char *skipSpaces(const char *p, const char *end) {
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+	return p;
+}
+
+/* every buffer the reader will ever use is allocated here, then the producer thread starts parsing. */
+TextSampleReader::TextSampleReader(istream &in, unsigned numInputs, unsigned numOutputs,
+	unsigned rowsPerBatch, unsigned numBatches, unsigned bufferSize)
+	: m_in(in), m_numInputs(numInputs), m_numOutputs(numOutputs), m_rowsPerBatch(max(1u, rowsPerBatch)),
+	  m_buffer(bufferSize), m_ring(max(2u, numBatches)), m_head(0), m_tail(0), m_filled(0),
+	  m_holding(false), m_inputsPending(false), m_done(false), m_stop(false) {
+	for (unsigned b = 0; b < m_ring.size(); ++b) {
+		m_ring[b].rows.resize(uint64_t(m_rowsPerBatch) * (numInputs + numOutputs));
+		m_ring[b].numRows = 0;
+	}
+	m_stats.batches = m_stats.stalls = 0;
+	m_stats.stallSeconds = m_stats.producerWaitSeconds = 0.0;
+	m_producer = thread(&TextSampleReader::produce, this);
+}
+
+TextSampleReader::~TextSampleReader() {
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_released.notify_all();
+	m_producer.join();
+}
+
+TextSampleReader::Stats TextSampleReader::getStats(void) const {
+	lock_guard<mutex> lock(m_mutex);
+	return m_stats;
+}
+
+/* hands the batch the trainer was holding back to the producer and waits (counting the stall) for the next one. */
+unsigned TextSampleReader::next(const double *&rows) {
+	unique_lock<mutex> lock(m_mutex);
+	if (m_holding) {
+		m_holding = false;
+		m_head = (m_head + 1) % m_ring.size();
+		--m_filled;
+		m_released.notify_one();
+	}
+	if (m_filled == 0 && !m_done) {
+		++m_stats.stalls;
+		chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+		m_parsed.wait(lock, [&] { return m_filled > 0 || m_done; });
+		m_stats.stallSeconds += chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+	}
+	if (m_filled == 0) return 0;
+	m_holding = true;
+	++m_stats.batches;
+	rows = m_ring[m_head].rows.data();
+	return m_ring[m_head].numRows;
+}
+
+/* makes the batch at m_tail visible to the trainer and waits until the slot after it is free to fill. the batch the
+   trainer is holding still counts as filled until it asks for the next one. false if the reader is being destroyed. */
+bool TextSampleReader::publish(void) {
+	unique_lock<mutex> lock(m_mutex);
+	if (m_ring[m_tail].numRows > 0) {
+		m_tail = (m_tail + 1) % m_ring.size();
+		++m_filled;
+		m_parsed.notify_one();
+	}
+	if (m_filled == m_ring.size() && !m_stop) {
+		chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+		m_released.wait(lock, [&] { return m_filled < m_ring.size() || m_stop; });
+		m_stats.producerWaitSeconds += chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+	}
+	m_ring[m_tail].numRows = 0;
+	return !m_stop;
+}
+
+/* parses one line into the batch being filled. returns false at the end of the data: a line that isn't an in: or
+   out: line (like the blank line at the end of the file) or one without exactly the topology's number of values. */
+bool TextSampleReader::parseLine(const char *begin, const char *end, Batch &batch) {
+	const char *p = skipSpaces(begin, end);
+	const char *labelEnd = p;
+	while (labelEnd < end && !isspace((unsigned char)*labelEnd)) ++labelEnd;
+	if (m_numOutputs == 0) return parseInputLine(p, labelEnd, end, batch);
+	bool isInput = labelEnd - p == 3 && memcmp(p, "in:", 3) == 0;
+	bool isOutput = labelEnd - p == 4 && memcmp(p, "out:", 4) == 0;
+	if (isInput == isOutput || isOutput != m_inputsPending) return false;
+	unsigned stride = m_numInputs + m_numOutputs;
+	double *values = &batch.rows[uint64_t(batch.numRows) * stride] + (isInput ? 0 : m_numInputs);
+	unsigned expected = isInput ? m_numInputs : m_numOutputs, count = 0;
+	p = skipSpaces(labelEnd, end);
+	while (p < end) {
+		double value;
+		if (count == expected || !parseDouble(p, end, value)) return false;
+		values[count++] = value;
+		p = skipSpaces(p, end);
+	}
+	if (count != expected) {
+		if (isOutput) cerr << "An out: line has " << count << " values instead of " << expected << ", stopping there.\n";
+		return false;
+	}
+	m_inputsPending = isInput;
+	if (isOutput) ++batch.numRows;
+	return true;
+}
+
+/* parses a line of an inputs only file. the values may follow an in: label or stand on their own, while blank,
+   topology: and out: lines are skipped so a training data file can be scored as it is. */
+bool TextSampleReader::parseInputLine(const char *p, const char *labelEnd, const char *end, Batch &batch) {
+	if (p == end || (labelEnd - p == 4 && memcmp(p, "out:", 4) == 0) || (labelEnd - p == 9 && memcmp(p, "topology:", 9) == 0)) return true;
+	if (labelEnd - p == 3 && memcmp(p, "in:", 3) == 0) p = skipSpaces(labelEnd, end);
+	double *values = &batch.rows[uint64_t(batch.numRows) * m_numInputs];
+	unsigned count = 0;
+	while (p < end) {
+		double value;
+		if (count == m_numInputs || !parseDouble(p, end, value)) break;
+		values[count++] = value;
+		p = skipSpaces(p, end);
+	}
+	if (p < end || count != m_numInputs) {
+		cerr << "An input line doesn't hold " << m_numInputs << " numbers, stopping there.\n";
+		return false;
+	}
+	++batch.numRows;
+	return true;
+}
+
+/* the producer thread: reads the file one block at a time and splits it into lines. an unfinished line at the end
+   of a block is moved to the front of the buffer and completed by the next read. */
+void TextSampleReader::produce(void) {
+	unsigned carried = 0;
+	bool ended = false;
+	while (!ended) {
+		m_in.read(&m_buffer[carried], m_buffer.size() - carried);
+		unsigned length = carried + unsigned(m_in.gcount());
+		bool lastBlock = !m_in;
+		const char *p = m_buffer.data(), *end = p + length;
+		while (!ended) {
+			const char *newline = static_cast<const char *>(memchr(p, '\n', end - p));
+			if (newline == NULL && !lastBlock) break;                // wait for the rest of this line
+			const char *lineEnd = newline != NULL ? newline : end;
+			if (p == end || !parseLine(p, lineEnd, m_ring[m_tail])) ended = true;
+			else if (m_ring[m_tail].numRows == m_rowsPerBatch && !publish()) return;
+			p = newline != NULL ? newline + 1 : end;
+		}
+		carried = unsigned(end - p);
+		if (!ended && carried == m_buffer.size()) {
+			cerr << "A line of the data file is longer than the read buffer, stopping there.\n";
+			ended = true;
+		}
+		memmove(m_buffer.data(), p, carried);
+	}
+	publish();
+	lock_guard<mutex> lock(m_mutex);
+	m_done = true;
+	m_parsed.notify_all();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#ifndef TextSampleReader_H
+#define TextSampleReader_H
+#include "Globalfuncs.h"
+using namespace std;
+
+/* streams the in:/out: lines of a text data file on a producer thread. the file is read in large blocks and the
+   numbers are parsed in place with from_chars into a bounded ring of batches, so once it is running the reader
+   allocates nothing and the trainer only waits when it gets ahead of the parser.
+   with numOutputs 0 the rows are input values only, for scoring files that have no targets. */
+class TextSampleReader {
+public:
+	struct Stats {
+		uint64_t batches;           // batches handed to the trainer
+		uint64_t stalls;            // times the trainer found no parsed batch waiting
+		double stallSeconds;        // total time the trainer spent waiting for one
+		double producerWaitSeconds; // total time the parser spent waiting for a free slot in the ring
+	};
+	TextSampleReader(istream &in, unsigned numInputs, unsigned numOutputs,
+		unsigned rowsPerBatch = 1024, unsigned numBatches = 4, unsigned bufferSize = 1 << 20);
+	~TextSampleReader();
+	unsigned next(const double *&rows); // the next batch of rows (inputs then targets), 0 at the end. invalidates the last one
+	Stats getStats(void) const;
+private:
+	struct Batch {
+		vector<double> rows;
+		unsigned numRows;
+	};
+	void produce(void);
+	bool parseLine(const char *begin, const char *end, Batch &batch);
+	bool parseInputLine(const char *p, const char *labelEnd, const char *end, Batch &batch);
+	bool publish(void);
+	istream &m_in;
+	unsigned m_numInputs, m_numOutputs, m_rowsPerBatch;
+	vector<char> m_buffer;           // one block of the file, plus the unfinished line carried over from the last one
+	vector<Batch> m_ring;
+	unsigned m_head, m_tail, m_filled; // next batch to hand out, next to fill, batches parsed and not yet handed out
+	bool m_holding;                  // the trainer still has the batch at m_head
+	bool m_inputsPending;            // an in: line was parsed, its out: line is next
+	bool m_done, m_stop;
+	Stats m_stats;
+	mutable mutex m_mutex;
+	condition_variable m_parsed, m_released;
+	thread m_producer;
+};
+#endif // !TextSampleReader_H
@@ -0,0 +1,39 @@
+#include "WorkPool.h"
+
+WorkPool::WorkPool(unsigned numThreads) : m_numThreads(max(1u, numThreads)), m_queues(new Queue[m_numThreads]), m_steals(0) {}
+
+void WorkPool::run(unsigned numTasks, const Work &work) {
+	for (unsigned task = 0; task < numTasks; ++task) m_queues[task % m_numThreads].tasks.push_back(task);
+	vector<thread> workers;
+	for (unsigned t = 0; t < m_numThreads; ++t) workers.push_back(thread(&WorkPool::worker, this, t, cref(work)));
+	for (unsigned t = 0; t < workers.size(); ++t) workers[t].join();
+}
+
+/* the victims are tried in turn from the next thread on, so the steals spread over the queues. no task is ever
+   added while the pool runs, so once every queue is empty there's nothing left to wait for. */
+bool WorkPool::take(unsigned thread, unsigned &task) {
+	{
+		lock_guard<mutex> lock(m_queues[thread].lock);
+		if (!m_queues[thread].tasks.empty()) {
+			task = m_queues[thread].tasks.back();
+			m_queues[thread].tasks.pop_back();
+			return true;
+		}
+	}
+	for (unsigned v = 1; v < m_numThreads; ++v) {
+		Queue &victim = m_queues[(thread + v) % m_numThreads];
+		lock_guard<mutex> lock(victim.lock);
+		if (!victim.tasks.empty()) {
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			++m_steals;
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkPool::worker(unsigned thread, const Work &work) {
+	unsigned task;
+	while (take(thread, task)) work(task, thread);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#ifndef WorkPool_H
+#define WorkPool_H
+#include "Globalfuncs.h"
+#include <deque>
+#include <functional>
+using namespace std;
+
+/* runs numbered tasks on a fixed number of threads. the tasks are dealt out to the threads in turn, every thread
+   works through its own queue from the back and, once that is empty, steals from the front of another thread's
+   queue. a thread that drew quick tasks helps with the slow ones instead of going idle, without all the threads
+   fighting over one shared queue. */
+class WorkPool {
+public:
+	typedef function<void(unsigned task, unsigned thread)> Work;
+	explicit WorkPool(unsigned numThreads);
+	void run(unsigned numTasks, const Work &work);   // returns once every task is done
+	uint64_t getSteals(void) const { return m_steals; }
+	unsigned getNumThreads(void) const { return m_numThreads; }
+private:
+	struct Queue {
+		mutex lock;
+		deque<unsigned> tasks;
+	};
+	bool take(unsigned thread, unsigned &task);      // its own task, or one stolen from another thread
+	void worker(unsigned thread, const Work &work);
+	unsigned m_numThreads;
+	unique_ptr<Queue[]> m_queues;                    // one per thread
+	atomic<uint64_t> m_steals;                       // tasks run by another thread than they were dealt to
+};
+#endif // !WorkPool_H